@@ -18,12 +18,16 @@
 
 #-std=c11 We use anonymous unions, anonymous structures and alligned_alloc
 
+#To bind the transmission control in at compile time rather than calling it through a function pointer (see
+#src/etcpTcStatic.h), eg for the fixed RTO TC:
+#  ./build.sh --append-CFLAGS="-DETCP_STATIC_TC_HDR='\"etcpTcRto.h\"' -DETCP_STATIC_TX_EVT_TC=etcpTcRto"
+
 #set -x
 
 INCLUDES="-I src -I ."
 CFLAGS="-D_GNU_SOURCE -D_XOPEN_SOURCE=700 -D_BSD_SOURCE -std=c11 -Werror -Wall -Wextra -pedantic -Wno-missing-field-initializers -Wno-unused-command-line-argument -Wno-missing-braces "
 #CFLAGS="-std=c11 -Werror -Wall -Wextra -pedantic -Wno-missing-field-initializers"
-LINKFLAGS="-lexanic"
+LINKFLAGS="-lexanic -lm"
 
 SRC="src/test.c"
 cake $SRC \
@@ -31,7 +35,7 @@ cake $SRC \
     --append-LINKFLAGS="$LINKFLAGS" \
     --no-git-root\
     --no-git-parent\
-    --begintests src/CircularQueueTest.c src/HashTableTest.c src/LinkedListTest.c --endtests \   
+    --begintests src/CircularQueueTest.c src/HashTableTest.c src/LinkedListTest.c src/ParityGroupTest.c src/FastCopyTest.c src/BitmapTest.c src/RttEstimatorTest.c src/ClockOffsetTest.c src/ClockModelTest.c src/ClockTest.c src/DelayCcTest.c src/BbrTest.c src/etcpTcBbrTest.c src/etcpTest.c --endtests \
     $@
 
   
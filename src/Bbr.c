@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: Bbr.c
+ *  Description:
+ *  Model based congestion control, in the style of BBR. A pacing rate and a window from estimates of the bottleneck
+ *  bandwidth and the round trip time.
+ */
+
+#include "Bbr.h"
+#include <string.h>
+
+#include "utils.h"
+#include "debug.h"
+
+#define BBR_NS_PER_SEC  (1000.0 * 1000.0 * 1000.0)
+#define BBR_HIGH_GAIN   (2.885) //2 / ln(2), the lowest gain that doubles the delivery rate every round trip
+#define BBR_DRAIN_GAIN  (1.0 / BBR_HIGH_GAIN)
+#define BBR_CWND_GAIN   (2.0)
+#define BBR_FULL_BW     (1.25)  //STARTUP goes on while the bandwidth goes up by this much...
+#define BBR_FULL_ROUNDS (3)     //...in this many round trips
+
+static const double bbrCycleGain[BBR_CYCLE_LEN] = { 1.25, 0.75, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+
+
+void bbrReset(bbr_t* const bbr, const bbrParams_t* const params)
+{
+    memset(bbr,0,sizeof(bbr_t));
+
+    const bbrParams_t defaults = {
+        .minRttWinNs = BBR_MIN_RTT_WIN_DEFAULT_NS,
+        .probeRttNs  = BBR_PROBE_RTT_DEFAULT_NS,
+        .initRttNs   = BBR_INIT_RTT_DEFAULT_NS,
+        .initCwnd    = BBR_INIT_CWND_DEFAULT,
+        .minCwnd     = BBR_MIN_CWND_DEFAULT,
+        .maxCwnd     = BBR_MAX_CWND_DEFAULT,
+    };
+    bbr->__params = params ? *params : defaults;
+    const bbrParams_t* const p = &bbr->__params;
+
+    bbr->mode       = bbrSTARTUP;
+    bbr->pacingGain = BBR_HIGH_GAIN;
+    bbr->cwndGain   = BBR_HIGH_GAIN;
+    bbr->minRttNs   = -1;
+    bbr->cwnd       = MAX(MIN(p->initCwnd, p->maxCwnd), p->minCwnd);
+    bbr->pacePps    = BBR_HIGH_GAIN * bbr->cwnd * BBR_NS_PER_SEC / (double)MAX(p->initRttNs, 1);
+    bbr->__probeRttDoneNs = -1;
+}
+
+
+double bbrBdp(const bbr_t* const bbr)
+{
+    if_unlikely(bbr->btlBwPps <= 0 || bbr->minRttNs <= 0){
+        return 0;
+    }
+    return bbr->btlBwPps * (double)bbr->minRttNs / BBR_NS_PER_SEC;
+}
+
+
+void bbrOnSend(bbr_t* const bbr, const i64 nowNs, const i64 inflight, const bool appLimited, bbrPkt_t* const pkt_o)
+{
+    //Starting from idle, there is no delivery to measure from, so measure from now
+    if_unlikely(inflight <= 0){
+        bbr->__firstSentNs = nowNs;
+        bbr->__deliveredNs = nowNs;
+    }
+
+    pkt_o->delivered   = bbr->delivered;
+    pkt_o->deliveredNs = bbr->__deliveredNs;
+    pkt_o->firstSentNs = bbr->__firstSentNs;
+    pkt_o->sentNs      = nowNs;
+    pkt_o->appLimited  = appLimited;
+}
+
+
+//The packets delivered while this one was out, over the longer of the time they took to send and the time they took to be
+//ack'd. Acks can bunch up on the way back, so the ack time alone could make the path look faster than it is.
+static void bbrRateSample(bbr_t* const bbr, const i64 nowNs, const bbrPkt_t* const pkt)
+{
+    const i64 sendNs     = pkt->sentNs - pkt->firstSentNs;
+    const i64 ackNs      = nowNs - pkt->deliveredNs;
+    const i64 intervalNs = MAX(sendNs, ackNs);
+    if_unlikely(intervalNs <= 0 || (bbr->minRttNs > 0 && intervalNs < bbr->minRttNs)){
+        return; //Too short to say anything about the path
+    }
+
+    const double pps = (double)(bbr->delivered - pkt->delivered) * BBR_NS_PER_SEC / (double)intervalNs;
+    if_unlikely(pkt->appLimited && pps < bbr->btlBwPps){
+        return; //The path wasn't the limit
+    }
+
+    double* const slot = &bbr->__bwPps[bbr->rounds % BBR_BW_ROUNDS];
+    *slot = MAX(*slot, pps);
+}
+
+
+static bool bbrUpdateMinRtt(bbr_t* const bbr, const i64 nowNs, const i64 rttNs)
+{
+    const bool expired = bbr->minRttNs >= 0 && nowNs - bbr->__minRttStampNs > bbr->__params.minRttWinNs;
+    if_unlikely(rttNs >= 0 && (bbr->minRttNs < 0 || rttNs <= bbr->minRttNs || expired)){
+        bbr->minRttNs = rttNs;
+        bbr->__minRttStampNs = nowNs;
+    }
+    return expired;
+}
+
+
+static void bbrCheckFullPipe(bbr_t* const bbr)
+{
+    if_likely(bbr->__filledPipe){
+        return;
+    }
+
+    if(bbr->btlBwPps >= bbr->__fullBwPps * BBR_FULL_BW){
+        bbr->__fullBwPps    = bbr->btlBwPps;
+        bbr->__fullBwRounds = 0;
+        return;
+    }
+    bbr->__fullBwRounds++;
+    bbr->__filledPipe = bbr->__fullBwRounds >= BBR_FULL_ROUNDS;
+}
+
+
+static void bbrEnterStartup(bbr_t* const bbr)
+{
+    bbr->mode       = bbrSTARTUP;
+    bbr->pacingGain = BBR_HIGH_GAIN;
+    bbr->cwndGain   = BBR_HIGH_GAIN;
+}
+
+
+static void bbrEnterProbeBw(bbr_t* const bbr, const i64 nowNs)
+{
+    //Start anywhere but the drain phase, so that flows that start together don't probe together
+    const i64 idx = (nowNs / 1000) % (BBR_CYCLE_LEN - 1);
+    bbr->mode       = bbrPROBE_BW;
+    bbr->cwndGain   = BBR_CWND_GAIN;
+    bbr->__cycleIdx = idx >= 1 ? idx + 1 : idx;
+    bbr->__cycleStampNs = nowNs;
+    bbr->__cycleLoss = false;
+    bbr->pacingGain = bbrCycleGain[bbr->__cycleIdx];
+}
+
+
+static void bbrAdvanceCycle(bbr_t* const bbr, const i64 nowNs, const i64 inflight)
+{
+    const double bdp    = bbrBdp(bbr);
+    const i64 elapsedNs = nowNs - bbr->__cycleStampNs;
+    const bool full     = elapsedNs > bbr->minRttNs;
+
+    bool next = full;
+    if(bbr->pacingGain > 1.0){
+        //Probing for more goes on until there is as much in flight as the probe wants, or there is a loss. The receiver's
+        //window may not let it get there, so give up after a couple of round trips
+        next = full && (bbr->__cycleLoss || (double)inflight >= bbr->pacingGain * bdp || elapsedNs > 2 * bbr->minRttNs);
+    }
+    else if(bbr->pacingGain < 1.0){
+        next = full || (double)inflight <= bdp; //The queue is already gone
+    }
+
+    if_unlikely(next){
+        bbr->__cycleIdx = (bbr->__cycleIdx + 1) % BBR_CYCLE_LEN;
+        bbr->__cycleStampNs = nowNs;
+        bbr->__cycleLoss = false;
+        bbr->pacingGain = bbrCycleGain[bbr->__cycleIdx];
+    }
+}
+
+
+static void bbrEnterProbeRtt(bbr_t* const bbr)
+{
+    bbr->__priorCwnd = bbr->__timedOut ? bbr->__priorCwnd : bbr->cwnd;
+    bbr->mode       = bbrPROBE_RTT;
+    bbr->pacingGain = 1.0;
+    bbr->cwndGain   = 1.0;
+    bbr->__probeRttDoneNs = -1;
+}
+
+
+//Hold the window down until it has been down for probeRttNs and at least one round trip, then go back to what it was
+static void bbrHandleProbeRtt(bbr_t* const bbr, const i64 nowNs, const i64 inflight, const bool roundStart)
+{
+    if(bbr->__probeRttDoneNs < 0){
+        if((double)inflight <= bbr->__params.minCwnd){
+            bbr->__probeRttDoneNs = nowNs + bbr->__params.probeRttNs;
+            bbr->__probeRttRoundDone = false;
+            bbr->__nextRoundDelivered = bbr->delivered;
+        }
+        return;
+    }
+
+    bbr->__probeRttRoundDone = bbr->__probeRttRoundDone || roundStart;
+    if(bbr->__probeRttRoundDone && nowNs >= bbr->__probeRttDoneNs){
+        bbr->__minRttStampNs = nowNs;
+        bbr->cwnd = MAX(bbr->cwnd, bbr->__priorCwnd);
+        if(bbr->__filledPipe){
+            bbrEnterProbeBw(bbr,nowNs);
+        }
+        else{
+            bbrEnterStartup(bbr);
+        }
+    }
+}
+
+
+static void bbrSetCwnd(bbr_t* const bbr, const i64 acked)
+{
+    const bbrParams_t* const p = &bbr->__params;
+    const double bdp    = bbrBdp(bbr);
+    const double target = bdp > 0 ? bbr->cwndGain * bdp : p->initCwnd;
+
+    //Once the pipe is full, the window goes straight to the target (if it can). Before then, it only ever grows.
+    if(bbr->__filledPipe){
+        bbr->cwnd = MIN(bbr->cwnd + (double)acked, target);
+    }
+    else if(bbr->cwnd < target || (double)bbr->delivered < p->initCwnd){
+        bbr->cwnd += (double)acked;
+    }
+    bbr->cwnd = MAX(MIN(bbr->cwnd, p->maxCwnd), p->minCwnd);
+
+    if_unlikely(bbr->mode == bbrPROBE_RTT){
+        bbr->cwnd = p->minCwnd;
+    }
+    if_unlikely(bbr->__timedOut){
+        bbr->cwnd = 1.0;
+    }
+}
+
+
+static void bbrSetPacing(bbr_t* const bbr)
+{
+    if_unlikely(bbr->btlBwPps <= 0){
+        if(bbr->minRttNs > 0){
+            bbr->pacePps = bbr->pacingGain * bbr->__params.initCwnd * BBR_NS_PER_SEC / (double)bbr->minRttNs;
+        }
+        return;
+    }
+
+    //Until the pipe is full, the first guess (from the initial window) may still be better than the model
+    const double pps = bbr->pacingGain * bbr->btlBwPps;
+    if(bbr->__filledPipe || pps > bbr->pacePps){
+        bbr->pacePps = pps;
+    }
+}
+
+
+void bbrOnAck(bbr_t* const bbr, const i64 nowNs, const bbrPkt_t* const pkt, const i64 acked, const i64 rttNs, const i64 inflight)
+{
+    bbr->delivered += MAX(acked, 0);
+    if_likely(acked > 0){
+        bbr->__deliveredNs = nowNs;
+    }
+
+    bool roundStart = false;
+    if_likely(pkt != NULL){
+        bbr->__firstSentNs = pkt->sentNs;
+        if(pkt->delivered >= bbr->__nextRoundDelivered){
+            bbr->__nextRoundDelivered = bbr->delivered;
+            bbr->rounds++;
+            bbr->__bwPps[bbr->rounds % BBR_BW_ROUNDS] = 0; //The oldest round trip drops out
+            roundStart = true;
+        }
+        bbrRateSample(bbr,nowNs,pkt);
+    }
+
+    bbr->btlBwPps = 0;
+    for(i64 i = 0; i < BBR_BW_ROUNDS; i++){
+        bbr->btlBwPps = MAX(bbr->btlBwPps, bbr->__bwPps[i]);
+    }
+
+    const bool minRttExpired = bbrUpdateMinRtt(bbr,nowNs,rttNs);
+    if(roundStart && !pkt->appLimited){
+        bbrCheckFullPipe(bbr);
+    }
+
+    if_unlikely(bbr->mode == bbrSTARTUP && bbr->__filledPipe){
+        bbr->mode       = bbrDRAIN;
+        bbr->pacingGain = BBR_DRAIN_GAIN;
+        bbr->cwndGain   = BBR_HIGH_GAIN;
+    }
+    if_unlikely(bbr->mode == bbrDRAIN && (double)inflight <= bbrBdp(bbr)){
+        bbrEnterProbeBw(bbr,nowNs);
+    }
+    if_likely(bbr->mode == bbrPROBE_BW){
+        bbrAdvanceCycle(bbr,nowNs,inflight);
+    }
+    if_unlikely(minRttExpired && bbr->mode != bbrPROBE_RTT){
+        bbrEnterProbeRtt(bbr);
+    }
+    if_unlikely(bbr->mode == bbrPROBE_RTT){
+        bbrHandleProbeRtt(bbr,nowNs,inflight,roundStart);
+    }
+
+    //Something new got through, so the path is back
+    if_unlikely(bbr->__timedOut && acked > 0){
+        bbr->__timedOut = false;
+        bbr->cwnd = MAX(bbr->cwnd, bbr->__priorCwnd);
+    }
+
+    bbrSetCwnd(bbr,acked);
+    bbrSetPacing(bbr);
+}
+
+
+void bbrOnLoss(bbr_t* const bbr)
+{
+    bbr->__cycleLoss = true;
+}
+
+
+void bbrOnTimeout(bbr_t* const bbr)
+{
+    if_likely(!bbr->__timedOut && bbr->mode != bbrPROBE_RTT){
+        bbr->__priorCwnd = bbr->cwnd;
+    }
+    bbr->__timedOut = true;
+    bbr->cwnd = 1.0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: Bbr.h
+ *  Description:
+ *  Model based congestion control, in the style of BBR. A pacing rate and a window from estimates of the bottleneck
+ *  bandwidth and the round trip time.
+ */
+#ifndef BBR_H_
+#define BBR_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * Neither loss nor delay says how fast the path actually is. This keeps a model of the path instead, from two numbers:
+ *  - The bottleneck bandwidth, the highest delivery rate seen over the last BBR_BW_ROUNDS round trips. Each ack of a packet
+ *    that was only sent once gives a delivery rate, the packets delivered between that packet being sent and it being ack'd,
+ *    over the time that took.
+ *  - The min RTT, the lowest RTT seen over the last minRttWinNs. Queues only ever add to the RTT, so this is the RTT with no
+ *    queue. When it gets old, the window is held down for a while (PROBE_RTT) so that the queue drains and it can be measured
+ *    again.
+ * Their product is the bandwidth delay product (BDP), the packets the path holds without queueing. Packets are paced out at
+ * about the bottleneck bandwidth, with a window of a couple of BDPs as a backstop. To keep the bandwidth estimate up to date,
+ * the pacing rate goes up by a quarter for one min RTT in eight, and down by a quarter for the next to drain whatever queue
+ * that built (PROBE_BW). A new flow doubles its rate every round trip until the bandwidth stops going up (STARTUP), then
+ * drains the queue that built while it found out (DRAIN).
+ *
+ * Loss only ends a probe for more bandwidth early. A retransmit timeout holds the window at one packet until something new is
+ * ack'd, then puts it back as it was.
+ */
+
+typedef enum {
+    bbrSTARTUP = 0,
+    bbrDRAIN,
+    bbrPROBE_BW,
+    bbrPROBE_RTT,
+} bbrMode_t;
+
+typedef struct {
+    i64 minRttWinNs;  //How long a min RTT sample lasts, before it is measured again
+    i64 probeRttNs;   //How long the window is held down to measure it
+    i64 initRttNs;    //The RTT to assume for the first pacing rate, until there is a sample
+    double initCwnd;  //Window before there is a bandwidth estimate, packets
+    double minCwnd;   //Window limits, packets. The window is held at minCwnd to measure the min RTT
+    double maxCwnd;
+} bbrParams_t;
+
+#define BBR_MIN_RTT_WIN_DEFAULT_NS (10 * 1000 * 1000 * 1000LL)
+#define BBR_PROBE_RTT_DEFAULT_NS   (200 * 1000 * 1000LL)
+#define BBR_INIT_RTT_DEFAULT_NS    (1000 * 1000LL)
+#define BBR_INIT_CWND_DEFAULT      (10.0)
+#define BBR_MIN_CWND_DEFAULT       (4.0)
+#define BBR_MAX_CWND_DEFAULT       (1024.0)
+
+#define BBR_BW_ROUNDS (10) //Round trips that the bottleneck bandwidth looks back over
+#define BBR_CYCLE_LEN (8)  //Phases in the PROBE_BW gain cycle, each one min RTT long
+
+//What the model needs to remember about each packet, from when it is sent until it is ack'd, for the delivery rate
+typedef struct {
+    i64 delivered;   //bbr_t.delivered when it was sent
+    i64 deliveredNs; //When the latest delivery before it was sent was ack'd
+    i64 firstSentNs; //When the packet of that delivery was sent
+    i64 sentNs;      //When it was sent
+    bool appLimited; //There wasn't anything else to send, so its delivery rate only says the path is at least that fast
+} bbrPkt_t;
+
+typedef struct {
+    bbrMode_t mode;
+    double btlBwPps;   //Bottleneck bandwidth, packets per second. 0 until the first delivery rate
+    i64 minRttNs;      //Min RTT, -1 until the first sample
+    double cwnd;       //Packets that may be in flight
+    double pacePps;    //Pacing rate, packets per second, see bbrPaceNs()
+    double pacingGain; //Pacing rate over the bottleneck bandwidth, for the current mode and phase
+    double cwndGain;   //Window over the BDP, likewise
+    i64 delivered;     //Packets ack'd so far
+    i64 rounds;        //Round trips so far
+
+    //__itmes are "private"
+    bbrParams_t __params;
+    double __bwPps[BBR_BW_ROUNDS]; //Highest delivery rate in each of the last round trips
+    i64 __nextRoundDelivered;      //The round trip ends when a packet sent after this many deliveries is ack'd
+    i64 __deliveredNs;
+    i64 __firstSentNs;
+    i64 __minRttStampNs;
+    double __fullBwPps;            //STARTUP is over when the bandwidth doesn't go up by a quarter for three round trips
+    i64 __fullBwRounds;
+    bool __filledPipe;
+    i64 __cycleIdx;
+    i64 __cycleStampNs;
+    bool __cycleLoss;              //A loss in this phase, which ends a probe for more bandwidth early
+    i64 __probeRttDoneNs;          //-1 until the window is down
+    bool __probeRttRoundDone;
+    double __priorCwnd;            //The window to go back to after PROBE_RTT or a timeout
+    bool __timedOut;
+} bbr_t;
+
+
+/**
+ * @brief           Forget everything and start up again. The state is a plain structure, so this is also how to initialise one.
+ * @param bbr       The state we're operating on
+ * @param params    The tuning, copied. NULL for the defaults
+ */
+void bbrReset(bbr_t* const bbr, const bbrParams_t* const params);
+
+/**
+ * @brief           A new packet is being sent (not a resend, those don't give delivery rates)
+ * @param bbr       The state we're operating on
+ * @param nowNs     The time now
+ * @param inflight  Packets in flight before this one
+ * @param appLimited Nothing else is waiting to be sent after this one, and the window isn't full
+ * @param pkt_o     What to give back to bbrOnAck() when it is ack'd
+ */
+void bbrOnSend(bbr_t* const bbr, const i64 nowNs, const i64 inflight, const bool appLimited, bbrPkt_t* const pkt_o);
+
+/**
+ * @brief           Packets have been ack'd
+ * @param bbr       The state we're operating on
+ * @param nowNs     The time now
+ * @param pkt       The newest packet ack'd, as given by bbrOnSend(). NULL if there isn't one that was only sent once
+ * @param acked     Number of packets ack'd
+ * @param rttNs     A new RTT sample, <0 if there isn't one
+ * @param inflight  Packets still in flight
+ */
+void bbrOnAck(bbr_t* const bbr, const i64 nowNs, const bbrPkt_t* const pkt, const i64 acked, const i64 rttNs, const i64 inflight);
+
+//A packet has been lost
+void bbrOnLoss(bbr_t* const bbr);
+
+//A retransmit timeout, nothing has got through for a while
+void bbrOnTimeout(bbr_t* const bbr);
+
+//The bandwidth delay product in packets, 0 until there is a model
+double bbrBdp(const bbr_t* const bbr);
+
+//Packets that may be in flight, at least 1
+static inline i64 bbrWindow(const bbr_t* const bbr)
+{
+    return bbr->cwnd < 1.0 ? 1 : (i64)bbr->cwnd;
+}
+
+//The gap to leave between sending packets
+static inline i64 bbrPaceNs(const bbr_t* const bbr)
+{
+    return (i64)(1000.0 * 1000.0 * 1000.0 / bbr->pacePps);
+}
+
+#endif /* BBR_H_ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: BbrTest.c
+ *  Description:
+ *  Some very basic sanity checks for the model based congestion control
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "Bbr.h"
+#include "utils.h"
+
+#define BBR_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+//A path with one bottleneck, sending one packet per us, and an RTT of 20us with no queue. So a BDP of 20 packets.
+#define SIM_PKT_NS  (1000LL)
+#define SIM_BASE_NS (20 * 1000LL)
+#define SIM_STEP_NS (100LL)
+#define SIM_PKTS    (1024)
+
+typedef struct {
+    bbrPkt_t pkt;
+    i64 ackNs;
+    i64 queueNs;
+} simPkt_t;
+
+typedef struct {
+    simPkt_t pkts[SIM_PKTS];
+    i64 sent;
+    i64 acked;
+    i64 lastDepartNs;
+    i64 nextTxNs;
+
+    i64 delivered;    //From statsFromNs on
+    i64 queueNsTotal;
+    i64 queueNsMax;
+    bool sawProbeRtt;
+    double probeRttCwndMax;
+} sim_t;
+
+
+//Send as fast as BBR lets us or, without it, keep fixedWin packets in flight (as the fixed RTO TC does)
+static void simRun(sim_t* const sim, bbr_t* const bbr, const i64 fixedWin, const i64 fromNs, const i64 toNs, const i64 statsFromNs)
+{
+    for(i64 nowNs = fromNs; nowNs < toNs; nowNs += SIM_STEP_NS){
+        while(sim->acked < sim->sent && sim->pkts[sim->acked % SIM_PKTS].ackNs <= nowNs){
+            const simPkt_t* const p = &sim->pkts[sim->acked % SIM_PKTS];
+            sim->acked++;
+            if(bbr){
+                bbrOnAck(bbr,nowNs,&p->pkt,1,nowNs - p->pkt.sentNs,sim->sent - sim->acked);
+            }
+            if(nowNs >= statsFromNs){
+                sim->delivered++;
+                sim->queueNsTotal += p->queueNs;
+                sim->queueNsMax = MAX(sim->queueNsMax, p->queueNs);
+            }
+        }
+
+        if(bbr && bbr->mode == bbrPROBE_RTT){
+            sim->sawProbeRtt = true;
+            sim->probeRttCwndMax = MAX(sim->probeRttCwndMax, bbr->cwnd);
+        }
+
+        const i64 window = bbr ? bbrWindow(bbr) : fixedWin;
+        while(sim->sent - sim->acked < window && sim->sent - sim->acked < SIM_PKTS && nowNs >= sim->nextTxNs){
+            simPkt_t* const p = &sim->pkts[sim->sent % SIM_PKTS];
+            if(bbr){
+                bbrOnSend(bbr,nowNs,sim->sent - sim->acked,false,&p->pkt);
+                sim->nextTxNs = nowNs + bbrPaceNs(bbr);
+            }
+            const i64 departNs = MAX(nowNs, sim->lastDepartNs) + SIM_PKT_NS;
+            p->queueNs = departNs - SIM_PKT_NS - nowNs;
+            p->ackNs   = departNs - SIM_PKT_NS + SIM_BASE_NS;
+            sim->lastDepartNs = departNs;
+            sim->sent++;
+        }
+    }
+}
+
+
+//Startup finds the bandwidth and the RTT, and a timeout holds the window at one until something is ack'd
+bool test1()
+{
+    bool result = true;
+    bbr_t bbr;
+    bbrReset(&bbr,NULL);
+    BBR_ASSERT(bbr.mode == bbrSTARTUP);
+    BBR_ASSERT(bbrWindow(&bbr) == (i64)BBR_INIT_CWND_DEFAULT);
+    BBR_ASSERT(bbr.minRttNs < 0 && bbrBdp(&bbr) == 0);
+
+    static sim_t sim = {0};
+    simRun(&sim,&bbr,0,0,5 * 1000 * 1000,0);
+    BBR_ASSERT(bbr.mode == bbrPROBE_BW);
+    BBR_ASSERT(bbr.minRttNs == SIM_BASE_NS);
+    BBR_ASSERT(bbr.btlBwPps > 0.9e6 && bbr.btlBwPps < 1.1e6);
+    BBR_ASSERT(bbrBdp(&bbr) > 18.0 && bbrBdp(&bbr) < 22.0);
+    BBR_ASSERT(bbr.cwnd > 1.5 * 18.0 && bbr.cwnd < 2.5 * 22.0);
+
+    const i64 window = bbrWindow(&bbr);
+    bbrOnTimeout(&bbr);
+    BBR_ASSERT(bbrWindow(&bbr) == 1);
+    bbrOnAck(&bbr,5 * 1000 * 1000,NULL,0,-1,0);
+    BBR_ASSERT(bbrWindow(&bbr) == 1);
+    bbrOnAck(&bbr,5 * 1000 * 1000,NULL,1,-1,0);
+    BBR_ASSERT(bbrWindow(&bbr) >= window);
+
+    return result;
+}
+
+
+//Once the min RTT gets old, the window is held down to measure it again, then goes back to where it was
+bool test2()
+{
+    bool result = true;
+    const bbrParams_t params = {
+        .minRttWinNs = 2 * 1000 * 1000,
+        .probeRttNs  = 200 * 1000,
+        .initRttNs   = 1000 * 1000,
+        .initCwnd    = 10.0,
+        .minCwnd     = 4.0,
+        .maxCwnd     = 1024.0,
+    };
+    bbr_t bbr;
+    bbrReset(&bbr,&params);
+
+    static sim_t sim = {0};
+    simRun(&sim,&bbr,0,0,10 * 1000 * 1000,0);
+    BBR_ASSERT(sim.sawProbeRtt);
+    BBR_ASSERT(sim.probeRttCwndMax == params.minCwnd);
+    BBR_ASSERT(bbr.mode == bbrPROBE_BW);
+    BBR_ASSERT(bbr.minRttNs == SIM_BASE_NS);
+    BBR_ASSERT(bbr.cwnd > 1.5 * 18.0);
+
+    return result;
+}
+
+
+//Against keeping the receiver's window in flight (the fixed RTO TC), it should get about as much through, with much less
+//of a queue at the bottleneck
+bool test3()
+{
+    bool result = true;
+    const i64 warmNs = 20 * 1000 * 1000;
+    const i64 endNs  = 100 * 1000 * 1000;
+    const double maxDelivered = (double)(endNs - warmNs) / SIM_PKT_NS;
+
+    bbr_t bbr;
+    bbrReset(&bbr,NULL);
+    static sim_t simBbr = {0};
+    simRun(&simBbr,&bbr,0,0,endNs,warmNs);
+
+    static sim_t simFixed = {0};
+    simRun(&simFixed,NULL,64,0,endNs,warmNs);
+
+    BBR_ASSERT(simFixed.delivered > 0.99 * maxDelivered);
+    BBR_ASSERT(simBbr.delivered > 0.95 * maxDelivered);
+
+    const i64 queueNsBbr   = simBbr.queueNsTotal / simBbr.delivered;
+    const i64 queueNsFixed = simFixed.queueNsTotal / simFixed.delivered;
+    BBR_ASSERT(queueNsFixed > 40 * SIM_PKT_NS);
+    BBR_ASSERT(queueNsBbr < queueNsFixed / 8);
+    BBR_ASSERT(simBbr.queueNsMax < simFixed.queueNsMax / 2);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: BBR Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: BBR Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: BBR Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
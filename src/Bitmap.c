@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: Bitmap.c
+ *  Description:
+ *  A circular bitmap, indexed by sequence number, for tracking the state of the slots in a window.
+ */
+
+#include "Bitmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "debug.h"
+
+
+bm_t* bmNew(const i64 bitCountLog2)
+{
+    if(bitCountLog2 < 0 || bitCountLog2 > 40){
+        return NULL;
+    }
+
+    bm_t* result = calloc(1,sizeof(bm_t));
+    if(!result){
+        return NULL;
+    }
+
+    result->bitCount    = 1LL << bitCountLog2;
+    result->__mask      = result->bitCount - 1;
+    result->__wordCount = (result->bitCount + 63) / 64;
+    result->__words     = calloc(result->__wordCount,sizeof(uint64_t));
+    if(!result->__words){
+        bmDelete(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+
+void bmDelete(bm_t* const bm)
+{
+    if(!bm){
+        return;
+    }
+
+    if(bm->__words){
+        free(bm->__words);
+    }
+
+    free(bm);
+}
+
+
+void bmSet(bm_t* const bm, const i64 seq)
+{
+    const i64 bit = seq & bm->__mask;
+    bm->__words[bit >> 6] |= 1ULL << (bit & 63);
+}
+
+
+void bmClear(bm_t* const bm, const i64 seq)
+{
+    const i64 bit = seq & bm->__mask;
+    bm->__words[bit >> 6] &= ~(1ULL << (bit & 63));
+}
+
+
+bool bmGet(const bm_t* const bm, const i64 seq)
+{
+    const i64 bit = seq & bm->__mask;
+    return (bm->__words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+
+//The bottom n bits set, for 0 <= n <= 64
+static inline uint64_t bmLow(const i64 n)
+{
+    return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+
+//How many sequence numbers from seq (up to "to") are in the same word, without running off the end of the bitmap
+static inline i64 bmChunkLen(const bm_t* const bm, const i64 seq, const i64 to)
+{
+    const i64 bit = seq & bm->__mask;
+    i64 n = 64 - (bit & 63);
+    n = MIN(n, bm->bitCount - bit);
+    n = MIN(n, to - seq);
+    return n;
+}
+
+
+//The bits for sequence numbers [seq, seq + n) as the bottom n bits of a word, where n comes from bmChunkLen()
+static inline uint64_t bmChunk(const bm_t* const set, const bm_t* const unset, const i64 seq, const i64 n)
+{
+    const i64 bit  = seq & set->__mask;
+    const i64 word = bit >> 6;
+    uint64_t x = set->__words[word];
+    if(unset){
+        x &= ~unset->__words[word];
+    }
+    return (x >> (bit & 63)) & bmLow(n);
+}
+
+
+void bmSetRange(bm_t* const bm, const i64 from, const i64 len)
+{
+    const i64 to = from + len;
+    i64 n = 0;
+    for(i64 seq = from; seq < to; seq += n){
+        n = bmChunkLen(bm,seq,to);
+        const i64 bit = seq & bm->__mask;
+        bm->__words[bit >> 6] |= bmLow(n) << (bit & 63);
+    }
+}
+
+
+void bmClearRange(bm_t* const bm, const i64 from, const i64 len)
+{
+    const i64 to = from + len;
+    i64 n = 0;
+    for(i64 seq = from; seq < to; seq += n){
+        n = bmChunkLen(bm,seq,to);
+        const i64 bit = seq & bm->__mask;
+        bm->__words[bit >> 6] &= ~(bmLow(n) << (bit & 63));
+    }
+}
+
+
+bool bmNextRun(const bm_t* const set, const bm_t* const unset, const i64 from, const i64 to, i64* const start_o, i64* const len_o)
+{
+    //Find the start, skipping a whole word at a time where there is nothing
+    i64 seq = from;
+    i64 n   = 0;
+    for(; seq < to; seq += n){
+        n = bmChunkLen(set,seq,to);
+        const uint64_t x = bmChunk(set,unset,seq,n);
+        if(x){
+            seq += __builtin_ctzll(x);
+            break;
+        }
+    }
+
+    if(seq >= to){
+        return false;
+    }
+
+    //Now find the end, skipping a whole word at a time where everything is in the run
+    const i64 start = seq;
+    for(; seq < to; seq += n){
+        n = bmChunkLen(set,seq,to);
+        const uint64_t x = ~bmChunk(set,unset,seq,n) & bmLow(n);
+        if(x){
+            seq += __builtin_ctzll(x);
+            break;
+        }
+    }
+
+    *start_o = start;
+    *len_o   = seq - start;
+    return true;
+}
+
+
+i64 bmFirstClear(const bm_t* const bm, const i64 from, const i64 to)
+{
+    i64 seq = from;
+    i64 n   = 0;
+    for(; seq < to; seq += n){
+        n = bmChunkLen(bm,seq,to);
+        const uint64_t x = ~bmChunk(bm,NULL,seq,n) & bmLow(n);
+        if(x){
+            return seq + __builtin_ctzll(x);
+        }
+    }
+
+    return to;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: Bitmap.h
+ *  Description:
+ *  A circular bitmap, indexed by sequence number, for tracking the state of the slots in a window.
+ */
+#ifndef BITMAP_H_
+#define BITMAP_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * A bitmap of 2^n bits, where bit i holds the state for every sequence number that is i (mod 2^n). This matches the way that
+ * the circular queue maps sequence numbers onto slots, so a bitmap with the same log2 size as a queue has one bit per slot.
+ * Sequence numbers are used directly everywhere, the bitmap does the wrapping.
+ *
+ * The point of the bitmap is that it can be searched a word (64 slots) at a time. Finding a run of slots in some state is a
+ * couple of ctz's rather than a walk over the slots (and the cache lines they live in).
+ */
+
+typedef struct {
+    i64 bitCount; //Number of bits, always a power of 2
+
+    //__itmes are "private"
+    i64 __mask;
+    i64 __wordCount;
+    uint64_t* __words;
+} bm_t;
+
+
+/**
+ * @brief               Create a new bitmap, with all bits clear
+ * @param bitCountLog2  log2 of the number of bits
+ * @return              On success a new a pointer to a new bm_t structure. On failure, NULL will be returned
+ */
+bm_t* bmNew(const i64 bitCountLog2);
+
+/**
+ * Free memory resoruces associated with this bitmap
+ * @param bm
+ */
+void bmDelete(bm_t* const bm);
+
+void bmSet(bm_t* const bm, const i64 seq);
+void bmClear(bm_t* const bm, const i64 seq);
+bool bmGet(const bm_t* const bm, const i64 seq);
+
+/**
+ * @brief           Set/clear the bits for sequence numbers from, from + 1, ... from + len - 1. len must be <= bitCount
+ */
+void bmSetRange(bm_t* const bm, const i64 from, const i64 len);
+void bmClearRange(bm_t* const bm, const i64 from, const i64 len);
+
+/**
+ * @brief           Find the first run of sequence numbers in [from, to) that are set in "set", and clear in "unset". Both
+ *                  bitmaps must be the same size, and to - from must be <= bitCount.
+ * @param unset     May be NULL, in which case it's just runs of bits set in "set"
+ * @param start_o   The first sequence number in the run
+ * @param len_o     Number of sequence numbers in the run. The run stops at "to", even if it would have gone further.
+ * @return          true if there is a run, false if there isn't (start_o and len_o are left alone)
+ */
+bool bmNextRun(const bm_t* const set, const bm_t* const unset, const i64 from, const i64 to, i64* const start_o, i64* const len_o);
+
+/**
+ * @brief           Find the first sequence number in [from, to) whose bit is clear. to - from must be <= bitCount.
+ * @return          The sequence number, or to if they are all set
+ */
+i64 bmFirstClear(const bm_t* const bm, const i64 from, const i64 to);
+
+#endif /* BITMAP_H_ */
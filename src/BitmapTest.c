@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: BitmapTest.c
+ *  Description:
+ *  Some very basic sanity checks for the bitmap structure
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Bitmap.h"
+
+#define BM_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+//Basic test allocate and free, should pass the valgrind and addresssanitizer checks
+bool test1()
+{
+    bool result = true;
+    bm_t* bm = bmNew(10);
+    BM_ASSERT(bm != NULL);
+    BM_ASSERT(bm->bitCount == 1024);
+    bmDelete(bm);
+    return result;
+}
+
+
+//Set, get and clear, including sequence numbers that wrap around
+bool test2()
+{
+    bool result = true;
+    bm_t* bm = bmNew(7);
+    BM_ASSERT(bm != NULL);
+
+    for(i64 seq = 1000; seq < 1000 + 128; seq += 3){
+        bmSet(bm,seq);
+    }
+    for(i64 seq = 1000; seq < 1000 + 128; seq++){
+        const bool want = (seq - 1000) % 3 == 0;
+        BM_ASSERT(bmGet(bm,seq) == want);
+        BM_ASSERT(bmGet(bm,seq + 128) == bmGet(bm,seq)); //Same slot
+    }
+    for(i64 seq = 1000; seq < 1000 + 128; seq += 3){
+        bmClear(bm,seq);
+    }
+    for(i64 seq = 0; seq < 128; seq++){
+        BM_ASSERT(!bmGet(bm,seq));
+    }
+
+    bmDelete(bm);
+    return result;
+}
+
+
+//Check runs, set/clear ranges and the first clear bit against a bit at a time version, on random bitmaps of different sizes
+bool test3()
+{
+    bool result = true;
+    srand(17);
+
+    for(i64 log2 = 0; log2 <= 9; log2++){
+        const i64 bits = 1LL << log2;
+        bm_t* set   = bmNew(log2);
+        bm_t* unset = bmNew(log2);
+        BM_ASSERT(set != NULL && unset != NULL);
+        const i64 mask = bits - 1;
+        bool refSet[512];
+        bool refUnset[512];
+
+        for(i64 round = 0; round < 200; round++){
+            const i64 from = rand() % 5000;
+            const i64 to   = from + rand() % (bits + 1);
+
+            //Fill in some random runs, from a random starting point so that some of them wrap
+            memset(set->__words,0,set->__wordCount * sizeof(uint64_t));
+            memset(unset->__words,0,unset->__wordCount * sizeof(uint64_t));
+            memset(refSet,0,sizeof(refSet));
+            memset(refUnset,0,sizeof(refUnset));
+            for(i64 i = 0; i < 8; i++){
+                const i64 start = rand() % 5000;
+                const i64 len   = rand() % (bits + 1);
+                bmSetRange(set,start,len);
+                for(i64 j = start; j < start + len; j++){
+                    refSet[j & mask] = true;
+                }
+            }
+            for(i64 i = 0; i < 2; i++){
+                const i64 start = rand() % 5000;
+                const i64 len   = rand() % (bits / 2 + 1);
+                bmClearRange(set,start,len);
+                for(i64 j = start; j < start + len; j++){
+                    refSet[j & mask] = false;
+                }
+            }
+            for(i64 i = 0; i < bits / 4; i++){
+                const i64 seq = rand() % 5000;
+                bmSet(unset,seq);
+                refUnset[seq & mask] = true;
+            }
+
+            for(i64 seq = 0; seq < bits; seq++){
+                BM_ASSERT(bmGet(set,seq) == refSet[seq]);
+            }
+
+            //Walk the runs, they should cover exactly the set & ~unset bits
+            i64 seq = from;
+            i64 start = -1;
+            i64 len = -1;
+            while(bmNextRun(set,unset,seq,to,&start,&len)){
+                BM_ASSERT(start >= seq && len > 0 && start + len <= to);
+                for(i64 j = seq; j < start; j++){
+                    BM_ASSERT(!(refSet[j & mask] && !refUnset[j & mask]));
+                }
+                for(i64 j = start; j < start + len; j++){
+                    BM_ASSERT(refSet[j & mask] && !refUnset[j & mask]);
+                }
+                BM_ASSERT(start + len == to || !(refSet[(start + len) & mask] && !refUnset[(start + len) & mask]));
+                seq = start + len;
+            }
+            for(i64 j = seq; j < to; j++){
+                BM_ASSERT(!(refSet[j & mask] && !refUnset[j & mask]));
+            }
+
+            //And the first clear bit
+            i64 firstClear = from;
+            while(firstClear < to && refSet[firstClear & mask]){
+                firstClear++;
+            }
+            BM_ASSERT(bmFirstClear(set,from,to) == firstClear);
+        }
+
+        bmDelete(set);
+        bmDelete(unset);
+    }
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Bitmap Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Bitmap Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Bitmap Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
@@ -15,6 +15,7 @@
 
 #include "utils.h"
 #include "debug.h"
+#include "FastCopy.h"
 
 //Slot count must be a power of 2 for performance reasons (to avoid a modulus on the critical path)
 cq_t* cqNew(const i64 buffSize, const i64 slotCountLog2)
@@ -125,27 +126,27 @@ cqError_t cqAdvWrSeq(cq_t* const cq)
         return cqENOCHANGE;
     }
 
+    //Slots can be committed out of order, so the write pointer may jump over several slots at once
+    const i64 advanced = seqNum - cq->wrSeq;
     cq->wrSeq = seqNum; //Write pointer has been advanced
     cq->wrMin = seqNum;
     cq->wrMax = cq->rdSeq + cq->__slotCount;
     cq->rdMax = cq->wrMin; //Pushing write forwards means there's more to read
-    cq->outstanding--;
-    cq->readable++;
-    cq->available--;
+    cq->outstanding -= advanced;
+    cq->readable    += advanced;
+    cq->available   -= advanced;
 
     return cqENOERR;
 }
 
 
-cqError_t cqAdvRdSeq(cq_t* const cq)
+//Move the read pointer up to the first full slot, starting the search at seqStart. Everything from rdSeq to seqStart must
+//already be known to be empty.
+static cqError_t cqAdvRdSeqFrom(cq_t* const cq, const i64 seqStart)
 {
-    if_unlikely(cq == NULL){
-        return cqENULLPARAM;
-    }
-
     cqSlot_t* slot = NULL;
     cqError_t err = cqENOERR;
-    i64 seqNum = cq->rdSeq;
+    i64 seqNum = seqStart;
 
     //DBG("Trying to advance rdSeq stating at %li\n", seqNum);
 
@@ -180,19 +181,31 @@ cqError_t cqAdvRdSeq(cq_t* const cq)
 
     //DBG("Done, new rdSeq %li\n", seqNum);
 
+    //Slots can be released out of order, so the read pointer may jump over several slots at once
+    const i64 advanced = seqNum - cq->rdSeq;
     cq->rdSeq = seqNum; //Write pointer has been advanced
     cq->rdMin = seqNum;
     cq->rdMax = cq->wrMin + 1;
     cq->wrMax = cq->rdMin + cq->__slotCount; //... but it does advance this
     cq->wrRng = cq->wrMax - cq->wrMin; //Maximum writable capacity
     cq->rdRng = cq->rdMax - cq->rdMin; //Maximum readable capacity
-    cq->readable--;
-    cq->available++;
+    cq->readable  -= advanced;
+    cq->available += advanced;
 
     return cqENOERR;
 }
 
 
+cqError_t cqAdvRdSeq(cq_t* const cq)
+{
+    if_unlikely(cq == NULL){
+        return cqENULLPARAM;
+    }
+
+    return cqAdvRdSeqFrom(cq,cq->rdSeq);
+}
+
+
 void cqDelete(cq_t* const cq)
 {
     if(!cq){
@@ -259,7 +272,7 @@ cqError_t cqPush(cq_t* const cq, const void* __restrict data, i64* const len_io,
     const i64 len = *len_io;
     const i64 toCopy = MIN(len, slot->len);
     *len_io = toCopy;
-    memcpy(slot->buff,data,toCopy);
+    fcCopy(slot->buff,data,toCopy);
 
     if(toCopy < len){
         return cqETRUNC;
@@ -291,7 +304,7 @@ cqError_t cqPull(cq_t* const cq, void* __restrict data, i64* const len_io, i64 c
     const i64 len = *len_io;
     const i64 toCopy = MIN(len, slot->len);
     *len_io = toCopy;
-    memcpy(data,slot->buff,toCopy);
+    fcCopy(data,slot->buff,toCopy);
 
     if(toCopy > slot->len){
         return cqETRUNC;
@@ -410,13 +423,39 @@ cqError_t cqReleaseSlot(cq_t* const cq, const i64 seqNum)
         return cqEWRONGSLOT;
     }
 
-    slot->len = cq->__slotSize;
+    slot->len = cq->slotDataSize;
     slot->valid = false;
 
     //Now try to move the read pointer as far forward as possible
    return cqAdvRdSeq(cq);
 }
 
+cqError_t cqReleaseRange(cq_t* const cq, const i64 seqFrom, const i64 count)
+{
+    if_unlikely(cq == NULL){
+        return cqENULLPARAM;
+    }
+
+    //Anything below the read pointer has been released already
+    const i64 seqTo  = seqFrom + count;
+    const i64 seqLo  = MAX(seqFrom, cq->rdSeq);
+    if_unlikely(seqTo > cq->rdSeq + cq->__slotCount){
+        return cqERANGEHI;
+    }
+
+    for(i64 seqNum = seqLo; seqNum < seqTo; seqNum++){
+        cqSlot_t* const slot = (cqSlot_t*)(cq->__slots + (seqNum & cq->__seqMask) * cq->__slotSize);
+        slot->len   = cq->slotDataSize;
+        slot->valid = false;
+    }
+
+    //Move the read pointer once for the whole range. If the range starts at the read pointer, the slots in it don't need to
+    //be looked at again.
+    const i64 seqStart = seqLo <= cq->rdSeq && seqTo > cq->rdSeq ? MIN(seqTo, cq->wrSeq) : cq->rdSeq;
+    return cqAdvRdSeqFrom(cq,seqStart);
+}
+
+
 //This is the same as the "cqGet" function, but it also checks that the slot is readable (ie, has valid data in it)
 cqError_t cqGetRd(const cq_t* const cq, cqSlot_t** slot_o, const i64 seqNum)
 {
@@ -149,6 +149,15 @@ cqError_t cqCommitSlot(cq_t* const cq, const i64 seqNum, const i64 len);
 cqError_t cqGetNextRd(cq_t* const cq, cqSlot_t** const slot_o, i64* const seqNum_o);
 cqError_t cqPullNext(cq_t* const cq, void* __restrict data, i64* const len_io, i64* const seqNum_o);
 cqError_t cqReleaseSlot(cq_t* const cq, const i64 seqNum);
+
+/**
+ * @brief           Release every slot in seqFrom, seqFrom + 1, ... seqFrom + count - 1, then push the read pointer forwards
+ *                  once. Slots that are already empty and sequence numbers below the read pointer are skipped.
+ * @return          ENOERROR  - the read pointer moved
+ *                  ENOCHANGE - the slots were released, but the read pointer did not move (there's a full slot before them)
+ *                  ERANGEHI  - the range goes beyond the end of the queue, nothing was released
+ */
+cqError_t cqReleaseRange(cq_t* const cq, const i64 seqFrom, const i64 count);
 cqError_t cqGetRd(const cq_t* const cq, cqSlot_t** slot_o, const i64 seqNum);
 
 
@@ -178,6 +178,96 @@ bool test5()
 }
 
 
+//Check that committing and releasing slots out of order keeps the pointers and counters consistent
+bool test6()
+{
+    bool result = true;
+    cqError_t err = cqENOERR;
+    cq_t* cq = cqNew(17,2);
+
+    //Commit 1,2,3 first, the write pointer should not move until 0 is in.
+    for(int i = 1; i < 4; i++){
+        err = cqCommitSlot(cq,i,17);
+        CQ_ASSERT(err == cqENOCHANGE);
+        CQ_ASSERT(cq->wrSeq == 0);
+    }
+    err = cqCommitSlot(cq,0,17);
+    CQ_ASSERT(err == cqENOERR);
+    CQ_ASSERT(cq->wrSeq == 4);
+    CQ_ASSERT(cq->readable == 4);
+    CQ_ASSERT(cq->available == 0);
+
+    //Release 3,2,1 first, the read pointer should not move until 0 is gone.
+    for(int i = 3; i > 0; i--){
+        err = cqReleaseSlot(cq,i);
+        CQ_ASSERT(err == cqENOCHANGE);
+        CQ_ASSERT(cq->rdSeq == 0);
+    }
+    err = cqReleaseSlot(cq,0);
+    CQ_ASSERT(err == cqENOERR);
+    CQ_ASSERT(cq->rdSeq == 4);
+    CQ_ASSERT(cq->readable == 0);
+    CQ_ASSERT(cq->available == 4);
+
+    cqDelete(cq);
+    return result;
+}
+
+
+//Release ranges of slots, out of order, overlapping, and across the end of the queue
+bool test7()
+{
+    bool result = true;
+    cqError_t err = cqENOERR;
+    cq_t* cq = cqNew(17,4);
+
+    for(int i = 0; i < 16; i++){
+        err = cqCommitSlot(cq,i,17);
+        CQ_ASSERT(err == cqENOERR);
+    }
+    CQ_ASSERT(cq->wrSeq == 16);
+
+    //A range after a full slot releases the slots, but the read pointer stays put
+    err = cqReleaseRange(cq,4,6);
+    CQ_ASSERT(err == cqENOCHANGE);
+    CQ_ASSERT(cq->rdSeq == 0);
+    CQ_ASSERT(cq->readable == 16);
+
+    //A range that overlaps the first one and fills the hole moves it past both in one go
+    err = cqReleaseRange(cq,0,5);
+    CQ_ASSERT(err == cqENOERR);
+    CQ_ASSERT(cq->rdSeq == 10);
+    CQ_ASSERT(cq->readable == 6);
+    CQ_ASSERT(cq->available == 10);
+
+    //Anything below the read pointer is already gone, anything past the end of the queue is an error
+    err = cqReleaseRange(cq,8,2);
+    CQ_ASSERT(err == cqENOCHANGE);
+    err = cqReleaseRange(cq,20,10);
+    CQ_ASSERT(err == cqERANGEHI);
+    CQ_ASSERT(cq->rdSeq == 10);
+
+    //Fill the queue again, so that it wraps, and release all of it
+    for(int i = 16; i < 26; i++){
+        err = cqCommitSlot(cq,i,17);
+        CQ_ASSERT(err == cqENOERR);
+    }
+    CQ_ASSERT(cq->wrSeq == 26);
+    err = cqReleaseRange(cq,10,16);
+    CQ_ASSERT(err == cqENOERR);
+    CQ_ASSERT(cq->rdSeq == 26);
+    CQ_ASSERT(cq->readable == 0);
+    CQ_ASSERT(cq->available == 16);
+
+    cqSlot_t* slot = NULL;
+    err = cqGetRd(cq,&slot,26);
+    CQ_ASSERT(err == cqEWRONGSLOT);
+
+    cqDelete(cq);
+    return result;
+}
+
+
 int main(int argc, char** argv)
 {
     (void)argc;
@@ -189,5 +279,7 @@ int main(int argc, char** argv)
     printf("ETCP Data Structures: Circular Queue Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
     printf("ETCP Data Structures: Circular Queue Test 04: ");  printf("%s", (test_pass = test4()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
     printf("ETCP Data Structures: Circular Queue Test 05: ");  printf("%s", (test_pass = test5()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Circular Queue Test 06: ");  printf("%s", (test_pass = test6()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Circular Queue Test 07: ");  printf("%s", (test_pass = test7()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
     return 0;
 }
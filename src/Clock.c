@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: Clock.c
+ *  Description:
+ *  Where the software time comes from. Either the system clock, the CPU's time stamp counter, or something user supplied.
+ */
+
+#include "Clock.h"
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "debug.h"
+
+
+bool clkTscInvariant()
+{
+#if defined(__x86_64__)
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if(!__get_cpuid(0x80000007, &a, &b, &c, &d)){
+        return false;
+    }
+    return (d >> 8) & 1; //"Invariant TSC" in the advanced power management leaf
+#else
+    return false;
+#endif
+}
+
+
+//The TSC is read in between two reads of the system clock, so the pair is out by at most half of the time in between
+void clkTscPair(clk_t* const clk)
+{
+    const i64 before = clkRealtimeNs();
+    const uint64_t tsc = clkTscRead();
+    const i64 after  = clkRealtimeNs();
+    cmSample(&clk->__tsc, tsc, before + (after - before) / 2, (after - before) / 2);
+}
+
+
+clkSrc_t clkInit(clk_t* const clk, const clkSrc_t src, const clkNow_f nowFn, void* const nowState)
+{
+    memset(clk,0,sizeof(clk_t));
+    clk->src = clkREALTIME;
+
+    if(src == clkUSER && nowFn != NULL){
+        clk->src        = clkUSER;
+        clk->__nowFn    = nowFn;
+        clk->__nowState = nowState;
+    }
+    else if(src == clkTSC && clkTscInvariant()){
+        //Pair the clocks as often as we can for a while, the clock model keeps the best pairs
+        cmReset(&clk->__tsc, CLK_TSC_PERIOD_NS);
+        const i64 startNs = clkRealtimeNs();
+        while(clkRealtimeNs() - startNs < CLK_TSC_CALIB_NS){
+            clkTscPair(clk);
+        }
+        clkTscPair(clk);
+
+        if(clk->__tsc.ready){
+            clk->src = clkTSC;
+            DBG("TSC calibrated at %.6f ns/tick\n", clk->__tsc.scale);
+        }
+        else{
+            WARN("Could not calibrate the TSC, using the system clock instead\n");
+        }
+    }
+    else if(src != clkREALTIME){
+        WARN("Clock source %i is not available, using the system clock instead\n", (int)src);
+    }
+
+    return clk->src;
+}
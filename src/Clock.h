@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: Clock.h
+ *  Description:
+ *  Where the software time comes from. Either the system clock, the CPU's time stamp counter, or something user supplied.
+ */
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "types.h"
+#include "utils.h"
+#include "ClockModel.h"
+
+/*
+ * All software times are CLOCK_REALTIME ns, since they are compared with the remote end's (see ClockOffset.h). Asking the
+ * system every time costs a clock_gettime() call. The time stamp counter (TSC) on modern x86 CPUs ticks at a constant rate
+ * whatever the CPU is doing (an "invariant" TSC), and reads in a few cycles. It is turned into CLOCK_REALTIME ns with a
+ * clock model (see ClockModel.h), which is calibrated when the clock is set up, and kept in line (NTP slews the system
+ * clock) by pairing the two again every CLK_TSC_PAIR_READS reads.
+ */
+
+typedef enum {
+    clkREALTIME = 0, //clock_gettime(CLOCK_REALTIME), always there
+    clkTSC,          //Invariant time stamp counter, where there is one
+    clkUSER,         //User supplied function, eg for simulated time
+} clkSrc_t;
+
+//A user supplied clock. Returns CLOCK_REALTIME ns (or something that passes for it)
+typedef i64 (*clkNow_f)(void* const clkState);
+
+#define CLK_TSC_PAIR_READS (1 << 16) //Reads between pairing the TSC with the system clock. Must be a power of 2
+#define CLK_TSC_CALIB_NS (10LL * 1000 * 1000) //How long to spend calibrating the TSC when the clock is set up
+#define CLK_TSC_PERIOD_NS (1000LL * 1000) //Clock model period, see ClockModel.h
+
+typedef struct {
+    clkSrc_t src;
+
+    //__itmes are "private"
+    i64 __reads;        //TSC reads so far, for pacing the pairing
+    cmModel_t __tsc;    //TSC ticks to CLOCK_REALTIME ns
+    clkNow_f __nowFn;   //For clkUSER
+    void* __nowState;
+} clk_t;
+
+
+/**
+ * @brief           Set up a clock. The TSC is calibrated here, which takes CLK_TSC_CALIB_NS.
+ * @param clk       The clock that we're operating on
+ * @param src       Where the time should come from. If there is no invariant TSC, it comes from the system clock instead.
+ * @param nowFn     For clkUSER only, otherwise NULL
+ * @param nowState  Passed to nowFn
+ * @return          Where the time will actually come from
+ */
+clkSrc_t clkInit(clk_t* const clk, const clkSrc_t src, const clkNow_f nowFn, void* const nowState);
+
+//Is there an invariant TSC on this CPU?
+bool clkTscInvariant();
+
+//Pair the TSC with the system clock again. Only for use by clkNowNs()
+void clkTscPair(clk_t* const clk);
+
+
+static inline i64 clkRealtimeNs()
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_REALTIME,&ts);
+    return ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+
+static inline uint64_t clkTscRead()
+{
+#if defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0; //Never used, clkInit() won't pick the TSC
+#endif
+}
+
+
+//The time now, in CLOCK_REALTIME ns
+static inline i64 clkNowNs(clk_t* const clk)
+{
+    if_likely(clk->src == clkTSC){
+        if_unlikely((++clk->__reads & (CLK_TSC_PAIR_READS - 1)) == 0){
+            clkTscPair(clk);
+        }
+        const i64 nowNs = cmHwToSw(&clk->__tsc, clkTscRead());
+        if_likely(nowNs != 0){
+            return nowNs;
+        }
+        return clkRealtimeNs(); //The model has lost track (the system clock jumped), until it catches up again
+    }
+
+    if_unlikely(clk->src == clkUSER){
+        return clk->__nowFn(clk->__nowState);
+    }
+
+    return clkRealtimeNs();
+}
+
+#endif /* CLOCK_H_ */
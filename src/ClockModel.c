@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockModel.c
+ *  Description:
+ *  A linear model from a hardware (NIC) clock to the host's software clock, fitted from paired readings of the two.
+ */
+
+#include "ClockModel.h"
+#include <string.h>
+
+#include "utils.h"
+#include "debug.h"
+
+
+void cmReset(cmModel_t* const cm, const i64 periodNs)
+{
+    memset(cm,0,sizeof(cmModel_t));
+    cm->__periodNs = periodNs;
+}
+
+
+void cmSample(cmModel_t* const cm, const i64 hwNs, const i64 swNs, const i64 errNs)
+{
+    const cmSample_t sample = { .hwNs = hwNs, .swNs = swNs, .errNs = errNs };
+
+    if_unlikely(cm->samples == 0){
+        cm->__anchor        = sample;
+        cm->__best          = sample;
+        cm->__periodStartNs = swNs;
+    }
+    else if_unlikely(swNs - cm->__periodStartNs >= cm->__periodNs){
+        //The period is over, its best pair is the new anchor. The scale is the move in both clocks since the last one.
+        const i64 hwMove = cm->__best.hwNs - cm->__anchor.hwNs;
+        const i64 swMove = cm->__best.swNs - cm->__anchor.swNs;
+        if_likely(hwMove > 0 && swMove > 0){
+            const double scale = (double)swMove / (double)hwMove;
+            cm->scale = cm->ready ? cm->scale + (scale - cm->scale) / 4 : scale;
+            cm->ready = true;
+            cm->__anchor = cm->__best;
+        }
+        else if_unlikely(hwMove != 0 || swMove != 0){ //Both 0 if nothing was better than the anchor, try the next period
+            WARN("Clock went backwards (hw %li, sw %li), starting the model again\n", hwMove, swMove);
+            cm->ready    = false;
+            cm->__anchor = sample;
+        }
+        cm->__best          = sample;
+        cm->__periodStartNs = swNs;
+    }
+    else if(errNs <= cm->__best.errNs){
+        cm->__best = sample;
+    }
+
+    cm->samples++;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockModel.h
+ *  Description:
+ *  A linear model from a hardware (NIC) clock to the host's software clock, fitted from paired readings of the two.
+ */
+#ifndef CLOCKMODEL_H_
+#define CLOCKMODEL_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * The hardware clock may count in anything (ns, cycles, ...) and run at a slightly different rate to the host's clock. The
+ * model is
+ *
+ *      sw = anchor.sw + (hw - anchor.hw) * scale
+ *
+ * so converting a timestamp is one multiply-add. The readings come in pairs (hw, sw) from whoever can read both clocks,
+ * along with how uncertain the pairing is (eg the time it took to read the hardware clock, with the software clock read on
+ * either side). In each period the most certain pair is kept. At the end of the period it becomes the new anchor, and the
+ * scale is taken from the move since the last anchor (smoothed).
+ *
+ * There is no scale to go on until the first period is over, so until then the model is not ready and converts nothing.
+ */
+
+typedef struct {
+    i64 hwNs;  //Hardware clock, in whatever units it counts in
+    i64 swNs;  //Software clock at the same moment
+    i64 errNs; //How far out the pairing could be
+} cmSample_t;
+
+typedef struct {
+    i64 samples; //Number of pairs so far
+    bool ready;  //There is a scale, so hardware times can be converted
+    double scale; //Software ns per hardware unit
+
+    //__itmes are "private"
+    i64 __periodNs;
+    i64 __periodStartNs;
+    cmSample_t __anchor; //Conversions are made from here
+    cmSample_t __best;   //The most certain pair of the current period
+} cmModel_t;
+
+
+/**
+ * @brief           Forget all pairs. The model is a plain structure, so this is also how to initialise one.
+ * @param cm        The model we're operating on
+ * @param periodNs  How often (software time) a new anchor is taken
+ */
+void cmReset(cmModel_t* const cm, const i64 periodNs);
+
+/**
+ * @brief           Take a new pair of readings
+ * @param cm        The model we're operating on
+ * @param hwNs      The hardware clock
+ * @param swNs      The software clock at the same moment
+ * @param errNs     How far out the pairing could be, >= 0
+ */
+void cmSample(cmModel_t* const cm, const i64 hwNs, const i64 swNs, const i64 errNs);
+
+/**
+ * @brief           Convert a hardware time into software time
+ * @param cm        The model we're operating on
+ * @return          The software time, or 0 if the model is not ready yet
+ */
+static inline i64 cmHwToSw(const cmModel_t* const cm, const i64 hwNs)
+{
+    if(!cm->ready){
+        return 0;
+    }
+    return cm->__anchor.swNs + (i64)((double)(hwNs - cm->__anchor.hwNs) * cm->scale);
+}
+
+#endif /* CLOCKMODEL_H_ */
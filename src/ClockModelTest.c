@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockModelTest.c
+ *  Description:
+ *  Some very basic sanity checks for the hardware to software clock model
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ClockModel.h"
+
+#define CM_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+static i64 absNs(const i64 x)
+{
+    return x < 0 ? -x : x;
+}
+
+//The hardware clock in the tests, counting in 6.4ns cycles from some time after the software clock, and running fast by
+//driftPpb
+static i64 hwClock(const i64 swNs, const i64 driftPpb)
+{
+    return (i64)((double)(swNs - 1000000007LL) / 6.4 * (1.0 + driftPpb / 1e9));
+}
+
+
+//Nothing is converted until the first period is over, perfect pairs give a perfect model after that
+bool test1()
+{
+    bool result = true;
+    cmModel_t cm;
+    cmReset(&cm,1000 * 1000);
+    CM_ASSERT(!cm.ready);
+    CM_ASSERT(cmHwToSw(&cm,12345) == 0);
+
+    i64 sw = 5000 * 1000 * 1000LL;
+    for(; sw < 5000 * 1000 * 1000LL + 900 * 1000; sw += 1000){
+        cmSample(&cm,hwClock(sw,0),sw,100);
+        CM_ASSERT(!cm.ready);
+    }
+    for(; sw < 5000 * 1000 * 1000LL + 10 * 1000 * 1000; sw += 1000){
+        cmSample(&cm,hwClock(sw,0),sw,100);
+    }
+    CM_ASSERT(cm.ready);
+
+    for(i64 t = sw; t < sw + 1000 * 1000; t += 997){
+        CM_ASSERT(absNs(cmHwToSw(&cm,hwClock(t,0)) - t) < 10);
+    }
+
+    //If the first pair is the most certain one in its period, the model waits for the next period rather than giving up
+    cmReset(&cm,1000 * 1000);
+    sw = 5000 * 1000 * 1000LL;
+    cmSample(&cm,hwClock(sw,0),sw,10);
+    for(sw += 1000; sw < 5000 * 1000 * 1000LL + 3 * 1000 * 1000; sw += 1000){
+        cmSample(&cm,hwClock(sw,0),sw,100);
+    }
+    CM_ASSERT(cm.ready);
+    CM_ASSERT(absNs(cmHwToSw(&cm,hwClock(sw,0)) - sw) < 10);
+
+    return result;
+}
+
+
+//A drifting hardware clock and noisy pairs. The model should stick to the most certain pairs, and keep up with the drift.
+bool test2()
+{
+    bool result = true;
+    srand(17);
+    const i64 driftPpb = 30000;
+    cmModel_t cm;
+    cmReset(&cm,10 * 1000 * 1000);
+
+    i64 errMax = 0;
+    for(i64 sw = 1000 * 1000 * 1000LL; sw < 3000 * 1000 * 1000LL; sw += 100 * 1000){
+        //The hardware clock was read somewhere inside a window of errNs around sw
+        const i64 errNs = rand() % 10 == 0 ? 20 : 200 + rand() % 5000;
+        const i64 hwAt  = sw + (rand() % (errNs + 1)) - errNs / 2;
+        cmSample(&cm,hwClock(hwAt,driftPpb),sw,errNs);
+
+        if(sw > 2000 * 1000 * 1000LL){
+            const i64 t   = sw + rand() % (10 * 1000 * 1000);
+            const i64 err = absNs(cmHwToSw(&cm,hwClock(t,driftPpb)) - t);
+            errMax = err > errMax ? err : errMax;
+        }
+    }
+    CM_ASSERT(cm.ready);
+    CM_ASSERT(errMax < 50);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Clock Model Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Clock Model Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
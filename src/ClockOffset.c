@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockOffset.c
+ *  Description:
+ *  Estimates the offset and drift of a peer's clock from round trip timestamps, for one way delays.
+ */
+
+#include "ClockOffset.h"
+#include <string.h>
+
+#include "utils.h"
+#include "debug.h"
+
+#define CO_NS_PER_SEC (1000LL * 1000 * 1000)
+
+
+void coReset(coEst_t* const est, const i64 periodNs)
+{
+    memset(est,0,sizeof(coEst_t));
+    est->__periodNs = periodNs;
+}
+
+
+i64 coOffsetAt(const coEst_t* const est, const i64 localNs)
+{
+    //Double, the drift times a few minutes would overflow
+    return est->__anchor.offsetNs + (i64)((double)est->driftPpb * (double)(localNs - est->__anchor.localNs) / CO_NS_PER_SEC);
+}
+
+
+void coSample(coEst_t* const est, const i64 t1, const i64 t2, const i64 t3, const i64 t4)
+{
+    const i64 delayNs = (t4 - t1) - (t3 - t2);
+    if_unlikely(t4 < t1 || t3 < t2 || delayNs < 0){
+        DBG("Ignoring clock sample %li %li %li %li, the times don't add up\n", t1, t2, t3, t4);
+        return;
+    }
+
+    const coSample_t sample = {
+        .localNs  = t1 + (t4 - t1) / 2,
+        .offsetNs = ((t2 - t1) + (t3 - t4)) / 2,
+        .delayNs  = delayNs,
+    };
+
+    if_unlikely(est->samples == 0){
+        est->__anchor        = sample;
+        est->__best          = sample;
+        est->__periodStartNs = sample.localNs;
+    }
+    else if_unlikely(sample.localNs - est->__periodStartNs >= est->__periodNs){
+        //The period is over, its best sample is the new anchor. The drift is the move in offset since the last one.
+        if_likely(est->__periods > 0 && est->__best.localNs > est->__anchor.localNs){
+            const double moveNs = est->__best.offsetNs - est->__anchor.offsetNs; //Double, a step in the clock would overflow
+            const i64 driftPpb  = moveNs * CO_NS_PER_SEC / (est->__best.localNs - est->__anchor.localNs);
+            est->driftPpb = est->__periods == 1 ? driftPpb : est->driftPpb + (driftPpb - est->driftPpb) / 4;
+        }
+        est->__anchor        = est->__best;
+        est->__best          = sample;
+        est->__periodStartNs = sample.localNs;
+        est->__periods++;
+    }
+    else if(sample.delayNs <= est->__best.delayNs){
+        est->__best = sample;
+        if_unlikely(est->__periods == 0){
+            est->__anchor = sample; //Nothing better to go on until the first period is over
+        }
+    }
+
+    est->samples++;
+    est->offsetNs = coOffsetAt(est,sample.localNs);
+    est->fwdNs    = MAX((t2 - t1) - coOffsetAt(est,t1), 0);
+    est->revNs    = MAX((t4 - t3) + coOffsetAt(est,t4), 0);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockOffset.h
+ *  Description:
+ *  Estimates the offset and drift of a peer's clock from round trip timestamps, for one way delays.
+ */
+#ifndef CLOCKOFFSET_H_
+#define CLOCKOFFSET_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * Each round trip gives four timestamps, the same as an NTP exchange:
+ *
+ *      t1 local send, t2 remote receive, t3 remote send (of the reply), t4 local receive
+ *
+ * From these, the offset of the remote clock is ((t2 - t1) + (t3 - t4)) / 2 and the time spent in the network is
+ * (t4 - t1) - (t3 - t2). The offset is only right if the trip there and the trip back took the same time, so it's taken from
+ * the sample with the least network time in each period, which has the least queueing to throw it off. The drift (how fast
+ * the remote clock gains on the local one) comes from the offsets of consecutive periods.
+ *
+ * With the offset known, each sample splits into a one way delay there (forward) and back (reverse), so queueing on one
+ * direction shows up on that direction alone. The base delay (the best case) can't be split this way, it's always shared
+ * out evenly between the two directions. That's a limit of round trip timestamps, not of this estimator.
+ */
+
+typedef struct {
+    i64 localNs;  //Local time of the sample, halfway between t1 and t4
+    i64 offsetNs; //Remote clock - local clock
+    i64 delayNs;  //Round trip network time, not including the time at the remote end
+} coSample_t;
+
+typedef struct {
+    i64 samples;    //Number of samples so far. Nothing below is valid until there is at least one
+    i64 offsetNs;   //Remote clock - local clock, as of the latest sample
+    i64 driftPpb;   //How fast the remote clock gains on the local one, in parts per billion. 0 until two periods have passed
+    i64 fwdNs;      //One way delay there (t1 to t2) of the latest sample
+    i64 revNs;      //One way delay back (t3 to t4) of the latest sample
+
+    //__itmes are "private"
+    i64 __periodNs;
+    i64 __periods;       //Number of periods finished
+    i64 __periodStartNs;
+    coSample_t __anchor; //The best sample of the last period, the offset is worked out from here
+    coSample_t __best;   //The best sample of the current period
+} coEst_t;
+
+
+/**
+ * @brief           Forget all samples. The estimator is a plain structure, so this is also how to initialise one.
+ * @param est       The estimator we're operating on
+ * @param periodNs  How often a new best sample is taken for the offset. Long enough to catch a sample without queueing in
+ *                  it, short enough that the drift doesn't move the offset too far in between
+ */
+void coReset(coEst_t* const est, const i64 periodNs);
+
+/**
+ * @brief           Take a new sample, t1 and t4 from the local clock, t2 and t3 from the remote one. Samples that can't be
+ *                  right (the remote end took longer than the whole round trip) are ignored.
+ * @param est       The estimator we're operating on
+ */
+void coSample(coEst_t* const est, const i64 t1, const i64 t2, const i64 t3, const i64 t4);
+
+/**
+ * @brief           The offset of the remote clock at a given local time, taking the drift into account
+ * @param est       The estimator we're operating on, with at least one sample
+ * @param localNs   Local time to work out the offset at
+ * @return          Remote clock - local clock
+ */
+i64 coOffsetAt(const coEst_t* const est, const i64 localNs);
+
+#endif /* CLOCKOFFSET_H_ */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockOffsetTest.c
+ *  Description:
+ *  Some very basic sanity checks for the clock offset estimator
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ClockOffset.h"
+
+#define CO_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+static i64 absNs(const i64 x)
+{
+    return x < 0 ? -x : x;
+}
+
+//The remote clock in the tests, offset from the local one and running fast by driftPpb
+static i64 remoteClock(const i64 localNs, const i64 offsetNs, const i64 driftPpb)
+{
+    return localNs + offsetNs + (i64)((double)localNs * driftPpb / 1e9);
+}
+
+
+//A single clean sample gives the offset and splits the delay evenly, nonsense samples are ignored
+bool test1()
+{
+    bool result = true;
+    coEst_t est;
+    coReset(&est,1000);
+
+    coSample(&est,100,50,40,200); //Remote end took longer than the round trip
+    CO_ASSERT(est.samples == 0);
+
+    //1000 each way, 500 at the far end, remote clock 7000 ahead
+    coSample(&est,10000,10000 + 1000 + 7000,10000 + 1500 + 7000,10000 + 2500);
+    CO_ASSERT(est.samples == 1);
+    CO_ASSERT(est.offsetNs == 7000);
+    CO_ASSERT(est.fwdNs == 1000);
+    CO_ASSERT(est.revNs == 1000);
+    CO_ASSERT(est.driftPpb == 0);
+
+    return result;
+}
+
+
+//Queueing in one direction shows up on that direction, and doesn't move the offset
+bool test2()
+{
+    bool result = true;
+    coEst_t est;
+    coReset(&est,1000 * 1000);
+
+    for(i64 i = 0; i < 100; i++){
+        const i64 t1 = i * 10000;
+        coSample(&est,t1,t1 + 1000 + 7000,t1 + 1500 + 7000,t1 + 2500);
+    }
+    const i64 t1 = 100 * 10000;
+    coSample(&est,t1,t1 + 1000 + 3000 + 7000,t1 + 1500 + 3000 + 7000,t1 + 3000 + 2500);
+    CO_ASSERT(est.offsetNs == 7000);
+    CO_ASSERT(est.fwdNs == 1000 + 3000);
+    CO_ASSERT(est.revNs == 1000);
+
+    return result;
+}
+
+
+//A drifting remote clock with random queueing in both directions. The offset and drift should be found from the samples
+//with the least queueing, and the one way delays should follow the queueing.
+bool test3()
+{
+    bool result = true;
+    srand(17);
+    const i64 offsetNs  = 123456789;
+    const i64 driftPpb  = 50000; //50ppm, a typical crystal
+    const i64 baseNs    = 5000;
+    const i64 remoteNs  = 2000;
+
+    coEst_t est;
+    coReset(&est,100 * 1000 * 1000);
+
+    i64 fwdErrMax = 0;
+    i64 revErrMax = 0;
+    for(i64 t1 = 1000 * 1000 * 1000LL; t1 < 4000 * 1000 * 1000LL; t1 += 10000){
+        const i64 fwdQ = rand() % 10 == 0 ? 0 : rand() % 20000;
+        const i64 revQ = rand() % 10 == 0 ? 0 : rand() % 20000;
+        const i64 t2   = t1 + baseNs + fwdQ;
+        const i64 t3   = t2 + remoteNs;
+        const i64 t4   = t3 + baseNs + revQ;
+        coSample(&est,remoteClock(t1,0,0),remoteClock(t2,offsetNs,driftPpb),remoteClock(t3,offsetNs,driftPpb),t4);
+
+        if(t1 > 2000 * 1000 * 1000LL){
+            fwdErrMax = absNs(est.fwdNs - (baseNs + fwdQ)) > fwdErrMax ? absNs(est.fwdNs - (baseNs + fwdQ)) : fwdErrMax;
+            revErrMax = absNs(est.revNs - (baseNs + revQ)) > revErrMax ? absNs(est.revNs - (baseNs + revQ)) : revErrMax;
+        }
+    }
+
+    const i64 t = 4000 * 1000 * 1000LL;
+    CO_ASSERT(absNs(coOffsetAt(&est,t) - (remoteClock(t,offsetNs,driftPpb) - t)) < 100);
+    CO_ASSERT(absNs(est.driftPpb - driftPpb) < driftPpb / 100);
+
+    //Well into the future (11 days on), where the drift times the time since the anchor is too big for an i64
+    const i64 farNs = 1000LL * 1000 * 1000 * 1000 * 1000;
+    CO_ASSERT(absNs(coOffsetAt(&est,farNs) - (remoteClock(farNs,offsetNs,driftPpb) - farNs)) < driftPpb * (farNs / 1000 / 1000 / 1000) / 50);
+    CO_ASSERT(fwdErrMax < 200);
+    CO_ASSERT(revErrMax < 200);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Clock Offset Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Clock Offset Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Clock Offset Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
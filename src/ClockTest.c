@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ClockTest.c
+ *  Description:
+ *  Some very basic sanity checks for the software clock sources
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "Clock.h"
+
+#define CLK_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+static i64 absNs(const i64 x)
+{
+    return x < 0 ? -x : x;
+}
+
+static i64 userNow(void* const clkState)
+{
+    i64* const nowNs = clkState;
+    return (*nowNs)++;
+}
+
+
+//The system clock and user clocks give what they're asked for, and a user clock with no function is the system clock
+bool test1()
+{
+    bool result = true;
+    clk_t clk;
+    CLK_ASSERT(clkInit(&clk,clkREALTIME,NULL,NULL) == clkREALTIME);
+    const i64 before = clkRealtimeNs();
+    const i64 nowNs  = clkNowNs(&clk);
+    const i64 after  = clkRealtimeNs();
+    CLK_ASSERT(before <= nowNs && nowNs <= after);
+
+    i64 userNs = 1234;
+    CLK_ASSERT(clkInit(&clk,clkUSER,userNow,&userNs) == clkUSER);
+    CLK_ASSERT(clkNowNs(&clk) == 1234);
+    CLK_ASSERT(clkNowNs(&clk) == 1235);
+    CLK_ASSERT(userNs == 1236);
+
+    CLK_ASSERT(clkInit(&clk,clkUSER,NULL,NULL) == clkREALTIME);
+
+    return result;
+}
+
+
+//The TSC clock keeps close to the system clock and never goes backwards by much, including across the pairings. Without an
+//invariant TSC, it should fall back to the system clock.
+bool test2()
+{
+    bool result = true;
+    clk_t clk;
+    const clkSrc_t src = clkInit(&clk,clkTSC,NULL,NULL);
+    if(!clkTscInvariant()){
+        CLK_ASSERT(src == clkREALTIME);
+        return result;
+    }
+    CLK_ASSERT(src == clkTSC);
+
+    i64 errMax  = 0;
+    i64 lastNs  = clkNowNs(&clk);
+    i64 backMax = 0;
+    for(i64 i = 0; i < 4 * CLK_TSC_PAIR_READS; i++){
+        const i64 before = clkRealtimeNs();
+        const i64 nowNs  = clkNowNs(&clk);
+        const i64 after  = clkRealtimeNs();
+        const i64 err    = absNs(nowNs - (before + (after - before) / 2)) - (after - before) / 2;
+        errMax  = err > errMax ? err : errMax;
+        backMax = lastNs - nowNs > backMax ? lastNs - nowNs : backMax;
+        lastNs  = nowNs;
+    }
+    //Generous, the test may be descheduled at any time
+    CLK_ASSERT(errMax < 50 * 1000);
+    CLK_ASSERT(backMax < 50 * 1000);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Clock Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Clock Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
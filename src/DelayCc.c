@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: DelayCc.c
+ *  Description:
+ *  Delay based congestion control, in the style of Swift. A congestion window driven by the queueing delay in the fabric.
+ */
+
+#include "DelayCc.h"
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+#include "debug.h"
+
+
+void dccReset(dcc_t* const dcc, const dccParams_t* const params)
+{
+    memset(dcc,0,sizeof(dcc_t));
+
+    const dccParams_t defaults = {
+        .targetNs  = DCC_TARGET_DEFAULT_NS,
+        .fsRangeNs = DCC_FS_RANGE_DEFAULT_NS,
+        .fsMinCwnd = DCC_FS_MIN_CWND_DEFAULT,
+        .fsMaxCwnd = DCC_FS_MAX_CWND_DEFAULT,
+        .ai        = DCC_AI_DEFAULT,
+        .beta      = DCC_BETA_DEFAULT,
+        .maxMdf    = DCC_MAX_MDF_DEFAULT,
+        .minCwnd   = DCC_MIN_CWND_DEFAULT,
+        .maxCwnd   = DCC_MAX_CWND_DEFAULT,
+    };
+    dcc->__params = params ? *params : defaults;
+
+    //Flow scaling goes from fsRangeNs at fsMinCwnd to 0 at fsMaxCwnd, in proportion to 1/sqrt(cwnd)
+    const dccParams_t* const p = &dcc->__params;
+    if_likely(p->fsRangeNs > 0 && p->fsMinCwnd > 0 && p->fsMaxCwnd > p->fsMinCwnd){
+        dcc->__fsAlpha = (double)p->fsRangeNs / (1.0 / sqrt(p->fsMinCwnd) - 1.0 / sqrt(p->fsMaxCwnd));
+        dcc->__fsBeta  = -dcc->__fsAlpha / sqrt(p->fsMaxCwnd);
+    }
+
+    dcc->cwnd = MAX(MIN(1.0, p->maxCwnd), p->minCwnd);
+    dcc->__lastDecreaseNs = INT64_MIN / 2;
+}
+
+
+i64 dccTargetNs(const dcc_t* const dcc)
+{
+    const dccParams_t* const p = &dcc->__params;
+    const double fs = dcc->__fsAlpha / sqrt(dcc->cwnd) + dcc->__fsBeta;
+    return p->targetNs + (i64)MAX(MIN(fs, (double)p->fsRangeNs), 0.0);
+}
+
+
+static inline void dccClamp(dcc_t* const dcc)
+{
+    dcc->cwnd = MAX(MIN(dcc->cwnd, dcc->__params.maxCwnd), dcc->__params.minCwnd);
+}
+
+
+//The window only comes down once per round trip, it takes that long for the last cut to show up in the delay
+static inline bool dccCanDecrease(const dcc_t* const dcc, const i64 nowNs, const i64 rttNs)
+{
+    return nowNs - dcc->__lastDecreaseNs >= rttNs;
+}
+
+
+void dccOnAck(dcc_t* const dcc, const i64 nowNs, const i64 delayNs, const i64 rttNs, const i64 acked)
+{
+    const dccParams_t* const p = &dcc->__params;
+
+    //Without a new sample (eg only resent packets were ack'd), the latest one is the best there is. Before the first one,
+    //there is no sign of a queue.
+    const i64 targetNs = dccTargetNs(dcc);
+    if_likely(delayNs >= 0){
+        dcc->samples++;
+        dcc->lastDelayNs = delayNs;
+    }
+    dcc->lastTargetNs = targetNs;
+    const i64 sampleNs = dcc->samples > 0 ? dcc->lastDelayNs : 0;
+
+    if_likely(sampleNs < targetNs){
+        //ai per round trip, which is a window's worth of acks. Below a window of 1, a round trip is less than one ack.
+        dcc->cwnd += dcc->cwnd >= 1.0 ? p->ai * acked / dcc->cwnd : p->ai * acked;
+    }
+    else if(dccCanDecrease(dcc,nowNs,rttNs)){
+        const double cut = MIN(p->beta * (double)(sampleNs - targetNs) / (double)sampleNs, p->maxMdf);
+        dcc->cwnd *= 1.0 - cut;
+        dcc->__lastDecreaseNs = nowNs;
+    }
+
+    dccClamp(dcc);
+}
+
+
+void dccOnLoss(dcc_t* const dcc, const i64 nowNs, const i64 rttNs)
+{
+    if_eqlikely(!dccCanDecrease(dcc,nowNs,rttNs)){
+        return;
+    }
+
+    dcc->cwnd *= 1.0 - dcc->__params.maxMdf;
+    dcc->__lastDecreaseNs = nowNs;
+    dccClamp(dcc);
+}
+
+
+void dccOnTimeout(dcc_t* const dcc, const i64 nowNs)
+{
+    dcc->cwnd = dcc->__params.minCwnd;
+    dcc->__lastDecreaseNs = nowNs;
+    dccClamp(dcc);
+}
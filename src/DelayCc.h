@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: DelayCc.h
+ *  Description:
+ *  Delay based congestion control, in the style of Swift. A congestion window driven by the queueing delay in the fabric.
+ */
+#ifndef DELAYCC_H_
+#define DELAYCC_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * Loss is a late sign of congestion. By the time a switch drops a packet its queue is already full, and in an incast the
+ * queue fills within a few packets from each sender. The delay through the fabric goes up as soon as a queue starts to build,
+ * so reacting to that keeps the queues short and the losses rare. With NIC timestamps at both ends, the fabric delay can be
+ * told apart from time spent in the hosts (see etcpLatency_t), which moves around for reasons that have nothing to do with
+ * the network.
+ *
+ * Each ack gives a delay sample, which is compared with a target:
+ *  - Under the target, the window grows by ai packets per round trip (additive increase)
+ *  - Over the target, it shrinks in proportion to how far over it is, by at most maxMdf, and at most once per round trip
+ *  - A loss shrinks it by maxMdf (once per round trip), a retransmit timeout takes it down to the minimum
+ *
+ * The target is raised for small windows (flow scaling), so that when lots of flows share a bottleneck and each of them has
+ * a small window, they still see a target they can meet. Windows can go below one packet, in which case packets are paced
+ * out, one every RTT / window.
+ */
+
+typedef struct {
+    i64 targetNs;    //Fabric delay that is fine. Should be a little above the uncongested fabric delay there and back
+    i64 fsRangeNs;   //Flow scaling, how much the target can be raised for small windows. 0 = no flow scaling
+    double fsMinCwnd; //The window at which the target is raised by all of fsRangeNs...
+    double fsMaxCwnd; //...and by none of it
+    double ai;       //Additive increase, packets per round trip
+    double beta;     //Multiplicative decrease, scaled by how far over the target the delay is
+    double maxMdf;   //Most the window is cut by in one go
+    double minCwnd;  //Window limits, packets
+    double maxCwnd;
+} dccParams_t;
+
+#define DCC_TARGET_DEFAULT_NS   (25 * 1000LL)
+#define DCC_FS_RANGE_DEFAULT_NS (5 * DCC_TARGET_DEFAULT_NS)
+#define DCC_FS_MIN_CWND_DEFAULT (0.1)
+#define DCC_FS_MAX_CWND_DEFAULT (100.0)
+#define DCC_AI_DEFAULT          (1.0)
+#define DCC_BETA_DEFAULT        (0.8)
+#define DCC_MAX_MDF_DEFAULT     (0.5)
+#define DCC_MIN_CWND_DEFAULT    (0.01)
+#define DCC_MAX_CWND_DEFAULT    (1024.0)
+
+typedef struct {
+    double cwnd;      //Congestion window, packets. May be less than 1, see dccPaceNs()
+    i64 samples;      //Delay samples so far
+    i64 lastDelayNs;  //The latest delay sample, used again until there is a new one
+    i64 lastTargetNs; //The target it was compared with
+
+    //__itmes are "private"
+    dccParams_t __params;
+    double __fsAlpha; //Flow scaling is alpha / sqrt(cwnd) + beta
+    double __fsBeta;
+    i64 __lastDecreaseNs;
+} dcc_t;
+
+
+/**
+ * @brief           Start again from a window of one packet. The state is a plain structure, so this is also how to initialise one.
+ * @param dcc       The state we're operating on
+ * @param params    The tuning, copied. NULL for the defaults
+ */
+void dccReset(dcc_t* const dcc, const dccParams_t* const params);
+
+/**
+ * @brief           Packets have been ack'd
+ * @param dcc       The state we're operating on
+ * @param nowNs     The time now
+ * @param delayNs   The fabric delay there and back from the latest ack, <0 if there isn't a new sample
+ * @param rttNs     The smoothed RTT, so that the window only comes down once per round trip
+ * @param acked     Number of packets ack'd
+ */
+void dccOnAck(dcc_t* const dcc, const i64 nowNs, const i64 delayNs, const i64 rttNs, const i64 acked);
+
+/**
+ * @brief           A packet has been lost
+ * @param dcc       The state we're operating on
+ * @param nowNs     The time now
+ * @param rttNs     The smoothed RTT, so that the window only comes down once per round trip
+ */
+void dccOnLoss(dcc_t* const dcc, const i64 nowNs, const i64 rttNs);
+
+/**
+ * @brief           A retransmit timeout, nothing has got through for a while
+ * @param dcc       The state we're operating on
+ * @param nowNs     The time now
+ */
+void dccOnTimeout(dcc_t* const dcc, const i64 nowNs);
+
+//The target delay for the current window, including flow scaling
+i64 dccTargetNs(const dcc_t* const dcc);
+
+//Packets that may be in flight, at least 1. Below a window of 1, the one packet is paced out, see dccPaceNs()
+static inline i64 dccWindow(const dcc_t* const dcc)
+{
+    return dcc->cwnd < 1.0 ? 1 : (i64)dcc->cwnd;
+}
+
+//The gap to leave between sending packets, 0 unless the window is below 1 packet
+static inline i64 dccPaceNs(const dcc_t* const dcc, const i64 rttNs)
+{
+    return dcc->cwnd < 1.0 ? (i64)((double)rttNs / dcc->cwnd) : 0;
+}
+
+#endif /* DELAYCC_H_ */
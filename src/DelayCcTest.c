@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: DelayCcTest.c
+ *  Description:
+ *  Some very basic sanity checks for the delay based congestion control
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "DelayCc.h"
+#include "utils.h"
+
+#define DCC_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+#define RTT_NS (20 * 1000LL)
+
+
+//The target is raised for small windows, the window grows under it, and comes down (once per round trip) over it
+bool test1()
+{
+    bool result = true;
+    dcc_t dcc;
+    dccReset(&dcc,NULL);
+    DCC_ASSERT(dcc.cwnd == 1.0);
+    DCC_ASSERT(dccWindow(&dcc) == 1);
+
+    //Flow scaling
+    const i64 target1 = dccTargetNs(&dcc);
+    DCC_ASSERT(target1 > DCC_TARGET_DEFAULT_NS && target1 <= DCC_TARGET_DEFAULT_NS + DCC_FS_RANGE_DEFAULT_NS);
+
+    //About ai per round trip, so 100 acks from a window of 1 is about sqrt(2 * 100)
+    i64 nowNs = 1000 * 1000;
+    for(int i = 0; i < 100; i++){
+        dccOnAck(&dcc,nowNs,DCC_TARGET_DEFAULT_NS / 2,RTT_NS,1);
+        nowNs += 1000;
+    }
+    DCC_ASSERT(dcc.cwnd > 12.0 && dcc.cwnd < 16.0);
+    DCC_ASSERT(dccTargetNs(&dcc) < target1);
+    DCC_ASSERT(dcc.samples == 100);
+
+    //Twice the target cuts by beta / 2, then nothing until a round trip later
+    const double cwnd = dcc.cwnd;
+    const i64 target = dccTargetNs(&dcc);
+    dccOnAck(&dcc,nowNs,2 * target,RTT_NS,1);
+    DCC_ASSERT(dcc.cwnd > cwnd * (1 - DCC_BETA_DEFAULT / 2) - 0.01 && dcc.cwnd < cwnd * (1 - DCC_BETA_DEFAULT / 2) + 0.01);
+    const double cut = dcc.cwnd;
+    dccOnAck(&dcc,nowNs + RTT_NS / 2,2 * target,RTT_NS,1);
+    DCC_ASSERT(dcc.cwnd == cut);
+
+    //Way over the target is cut by maxMdf at most
+    dccOnAck(&dcc,nowNs + RTT_NS,1000 * target,RTT_NS,1);
+    DCC_ASSERT(dcc.cwnd > cut * (1 - DCC_MAX_MDF_DEFAULT) - 0.01 && dcc.cwnd < cut * (1 - DCC_MAX_MDF_DEFAULT) + 0.01);
+
+    //No new sample, the latest one (way over) still counts
+    const double before = dcc.cwnd;
+    dccOnAck(&dcc,nowNs + 10 * RTT_NS,-1,RTT_NS,1);
+    DCC_ASSERT(dcc.cwnd < before);
+    DCC_ASSERT(dcc.samples == 103);
+
+    //Before the first sample, the window grows
+    dccReset(&dcc,NULL);
+    dccOnAck(&dcc,nowNs,-1,RTT_NS,1);
+    DCC_ASSERT(dcc.cwnd == 1.0 + DCC_AI_DEFAULT);
+    DCC_ASSERT(dcc.samples == 0);
+
+    return result;
+}
+
+
+//Loss, timeouts, the limits, and pacing below a window of 1
+bool test2()
+{
+    bool result = true;
+    dccParams_t params = {
+        .targetNs  = 10 * 1000,
+        .fsRangeNs = 0,
+        .ai        = 1.0,
+        .beta      = 0.8,
+        .maxMdf    = 0.5,
+        .minCwnd   = 0.1,
+        .maxCwnd   = 8.0,
+    };
+    dcc_t dcc;
+    dccReset(&dcc,&params);
+    DCC_ASSERT(dccTargetNs(&dcc) == 10 * 1000);
+
+    i64 nowNs = 1000 * 1000;
+    for(int i = 0; i < 1000; i++){
+        dccOnAck(&dcc,nowNs++,0,RTT_NS,1);
+    }
+    DCC_ASSERT(dcc.cwnd == 8.0);
+    DCC_ASSERT(dccWindow(&dcc) == 8);
+    DCC_ASSERT(dccPaceNs(&dcc,RTT_NS) == 0);
+
+    dccOnLoss(&dcc,nowNs,RTT_NS);
+    DCC_ASSERT(dcc.cwnd == 4.0);
+    dccOnLoss(&dcc,nowNs + 1,RTT_NS); //Same round trip
+    DCC_ASSERT(dcc.cwnd == 4.0);
+
+    dccOnTimeout(&dcc,nowNs);
+    DCC_ASSERT(dcc.cwnd == 0.1);
+    DCC_ASSERT(dccWindow(&dcc) == 1);
+    DCC_ASSERT(dccPaceNs(&dcc,RTT_NS) == 10 * RTT_NS);
+
+    //Below a window of 1, each ack is worth ai
+    dccOnAck(&dcc,nowNs + RTT_NS,0,RTT_NS,1);
+    DCC_ASSERT(dcc.cwnd > 1.09 && dcc.cwnd < 1.11);
+
+    return result;
+}
+
+
+//An incast. Lots of flows, starting with very different windows, into one bottleneck. The queue should settle close to the
+//target, rather than growing until something is dropped, and the flows should end up with similar windows.
+bool test3()
+{
+    bool result = true;
+    #define FLOWS (32)
+    const double bdp    = 16.0;     //Packets the fabric holds without queueing
+    const i64 baseNs    = 8 * 1000; //Fabric delay with no queue
+    const double pktNs  = 500.0;    //Time for the bottleneck to send one packet
+
+    dcc_t dcc[FLOWS];
+    for(int f = 0; f < FLOWS; f++){
+        dccReset(&dcc[f],NULL);
+        dcc[f].cwnd = 1.0 + f * 2;
+    }
+
+    i64 nowNs = 1000 * 1000;
+    i64 delayNs = baseNs;
+    i64 delayMax = 0;
+    for(int rtt = 0; rtt < 2000; rtt++){
+        double inFlight = 0;
+        for(int f = 0; f < FLOWS; f++){
+            inFlight += dcc[f].cwnd;
+        }
+        delayNs = baseNs + (i64)(MAX(inFlight - bdp, 0.0) * pktNs);
+        delayMax = rtt >= 1000 && delayNs > delayMax ? delayNs : delayMax;
+
+        //Each flow gets a window's worth of acks (at least one) per round trip
+        for(int f = 0; f < FLOWS; f++){
+            const i64 acks = dcc[f].cwnd < 1.0 ? 1 : (i64)dcc[f].cwnd;
+            for(i64 a = 0; a < acks; a++){
+                dccOnAck(&dcc[f],nowNs,delayNs,delayNs,1);
+            }
+        }
+        nowNs += delayNs;
+    }
+
+    double cwndMin = dcc[0].cwnd;
+    double cwndMax = dcc[0].cwnd;
+    for(int f = 0; f < FLOWS; f++){
+        cwndMin = MIN(cwndMin, dcc[f].cwnd);
+        cwndMax = MAX(cwndMax, dcc[f].cwnd);
+    }
+    DCC_ASSERT(delayMax < dccTargetNs(&dcc[0]) * 5 / 4);
+    DCC_ASSERT(cwndMax < cwndMin * 5 / 4);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Delay CC Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Delay CC Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Delay CC Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
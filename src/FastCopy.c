@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: FastCopy.c
+ *  Description:
+ *  Payload copy kernels, picked by size and by what the CPU supports.
+ */
+
+#include "FastCopy.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "utils.h"
+#include "debug.h"
+
+
+static i64 fcStreamThresh = FC_STREAM_THRESH_DEFAULT;
+static i64 fcStreamed     = 0;
+
+void fcSetStreamThreshold(const i64 bytes)
+{
+    fcStreamThresh = bytes < 0 ? INT64_MAX : bytes;
+}
+
+
+//Vectors are unaligned loads/stores via memcpy, which the compiler turns into single vector moves. The clones mean that
+//the widest vector unit on the CPU is picked once at load time rather than being fixed at compile time.
+typedef uint64_t fcVec_t __attribute__((vector_size(32)));
+
+#if defined(__x86_64__)
+__attribute__((target_clones("avx512f","avx2","default")))
+#endif
+void fcCopyCached(void* __restrict dst, const void* __restrict src, const i64 len)
+{
+    i8* const d       = dst;
+    const i8* const s = src;
+    i64 i = 0;
+
+    //Unroll by 4 vectors (128B, two cache lines) to keep the load ports busy
+    for(; i + 4 * (i64)sizeof(fcVec_t) <= len; i += 4 * sizeof(fcVec_t)){
+        fcVec_t a[4];
+        memcpy(a, s + i, sizeof(a));
+        memcpy(d + i, a, sizeof(a));
+    }
+
+    for(; i + (i64)sizeof(fcVec_t) <= len; i += sizeof(fcVec_t)){
+        fcVec_t a;
+        memcpy(&a, s + i, sizeof(a));
+        memcpy(d + i, &a, sizeof(a));
+    }
+
+    if(i < len){
+        memcpy(d + i, s + i, len - i);
+    }
+}
+
+
+#if defined(__x86_64__)
+
+//Non-temporal stores need to be aligned. Each kernel copies the head with ordinary stores up to the first aligned address
+//in dst, streams the aligned middle, then copies the tail with ordinary stores again. The loads can be unaligned.
+
+__attribute__((target("avx512f")))
+static void fcStreamAvx512(void* __restrict dst, const void* __restrict src, i64 len)
+{
+    i8* d       = dst;
+    const i8* s = src;
+    const i64 head = MIN(len, (i64)((64 - ((uintptr_t)d & 63)) & 63));
+    fcCopyCached(d, s, head);
+    d += head; s += head; len -= head;
+
+    for(; len >= 256; d += 256, s += 256, len -= 256){
+        const __m512i a = _mm512_loadu_si512(s);
+        const __m512i b = _mm512_loadu_si512(s + 64);
+        const __m512i c = _mm512_loadu_si512(s + 128);
+        const __m512i e = _mm512_loadu_si512(s + 192);
+        _mm512_stream_si512((__m512i*)d,         a);
+        _mm512_stream_si512((__m512i*)(d + 64),  b);
+        _mm512_stream_si512((__m512i*)(d + 128), c);
+        _mm512_stream_si512((__m512i*)(d + 192), e);
+    }
+    for(; len >= 64; d += 64, s += 64, len -= 64){
+        _mm512_stream_si512((__m512i*)d, _mm512_loadu_si512(s));
+    }
+    _mm_sfence();
+
+    fcCopyCached(d, s, len);
+}
+
+
+__attribute__((target("avx2")))
+static void fcStreamAvx2(void* __restrict dst, const void* __restrict src, i64 len)
+{
+    i8* d       = dst;
+    const i8* s = src;
+    const i64 head = MIN(len, (i64)((32 - ((uintptr_t)d & 31)) & 31));
+    fcCopyCached(d, s, head);
+    d += head; s += head; len -= head;
+
+    for(; len >= 128; d += 128, s += 128, len -= 128){
+        const __m256i a = _mm256_loadu_si256((const __m256i*)s);
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+        const __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+        const __m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+        _mm256_stream_si256((__m256i*)d,        a);
+        _mm256_stream_si256((__m256i*)(d + 32), b);
+        _mm256_stream_si256((__m256i*)(d + 64), c);
+        _mm256_stream_si256((__m256i*)(d + 96), e);
+    }
+    for(; len >= 32; d += 32, s += 32, len -= 32){
+        _mm256_stream_si256((__m256i*)d, _mm256_loadu_si256((const __m256i*)s));
+    }
+    _mm_sfence();
+
+    fcCopyCached(d, s, len);
+}
+
+
+//Every x86_64 CPU has SSE2
+static void fcStreamSse2(void* __restrict dst, const void* __restrict src, i64 len)
+{
+    i8* d       = dst;
+    const i8* s = src;
+    const i64 head = MIN(len, (i64)((16 - ((uintptr_t)d & 15)) & 15));
+    fcCopyCached(d, s, head);
+    d += head; s += head; len -= head;
+
+    for(; len >= 64; d += 64, s += 64, len -= 64){
+        const __m128i a = _mm_loadu_si128((const __m128i*)s);
+        const __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+        const __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+        const __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_stream_si128((__m128i*)d,        a);
+        _mm_stream_si128((__m128i*)(d + 16), b);
+        _mm_stream_si128((__m128i*)(d + 32), c);
+        _mm_stream_si128((__m128i*)(d + 48), e);
+    }
+    for(; len >= 16; d += 16, s += 16, len -= 16){
+        _mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+    }
+    _mm_sfence();
+
+    fcCopyCached(d, s, len);
+}
+
+#endif
+
+
+typedef void (*fcKernel_f)(void* __restrict dst, const void* __restrict src, i64 len);
+static fcKernel_f fcStreamKernel = NULL;
+
+//Pick the streaming kernel from CPUID. This is cheap and always picks the same answer, so it doesn't matter if two threads
+//race to do it.
+static fcKernel_f fcStreamKernelGet()
+{
+    if_likely(fcStreamKernel != NULL){
+        return fcStreamKernel;
+    }
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        fcStreamKernel = fcStreamAvx512;
+    }
+    else if(__builtin_cpu_supports("avx2")){
+        fcStreamKernel = fcStreamAvx2;
+    }
+    else{
+        fcStreamKernel = fcStreamSse2;
+    }
+#else
+    fcStreamKernel = fcCopyCached; //No streaming stores that we know about, an ordinary copy will have to do
+#endif
+
+    return fcStreamKernel;
+}
+
+
+void fcCopyStream(void* __restrict dst, const void* __restrict src, const i64 len)
+{
+    fcStreamed++;
+    fcStreamKernelGet()(dst, src, len);
+}
+
+
+void fcCopy(void* __restrict dst, const void* __restrict src, const i64 len)
+{
+    if_likely(len < fcStreamThresh){
+        fcCopyCached(dst, src, len);
+        return;
+    }
+
+    fcStreamed++;
+    fcStreamKernelGet()(dst, src, len);
+}
+
+
+i64 fcStreamCount()
+{
+    return fcStreamed;
+}
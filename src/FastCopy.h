@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: FastCopy.h
+ *  Description:
+ *  Payload copy kernels, picked by size and by what the CPU supports.
+ */
+#ifndef FASTCOPY_H_
+#define FASTCOPY_H_
+
+#include "types.h"
+
+/*
+ * There are two kinds of copy:
+ *
+ *  - Cached copies use ordinary stores, with the widest vectors the CPU has (chosen at load time). The destination ends up
+ *    in the cache, which is what we want when it is about to be used.
+ *  - Streaming copies use non-temporal stores, which go (more or less) straight to memory. The destination does not end up
+ *    in the cache, and more importantly, nothing else gets evicted to make room for it. This is what we want for bulk
+ *    payloads, which would otherwise push the hot headers and slots of the latency sensitive flows out of L1/L2.
+ *
+ * fcCopy() picks between them by size. Anything at or above the stream threshold is streamed. Where the caller knows that
+ * the data won't be looked at again soon (eg bulk data handed over to the user), it calls fcCopyStream() directly.
+ */
+
+#define FC_STREAM_THRESH_DEFAULT (4 * 1024) //Bigger than any frame (see MAX_FRAME), so the stack's own slot copies stay cached
+
+/**
+ * @brief           Copy len bytes from src to dst, streaming if len is at or above the stream threshold
+ */
+void fcCopy(void* __restrict dst, const void* __restrict src, const i64 len);
+
+/**
+ * @brief           Copy len bytes from src to dst with ordinary (cached) stores
+ */
+void fcCopyCached(void* __restrict dst, const void* __restrict src, const i64 len);
+
+/**
+ * @brief           Copy len bytes from src to dst with non-temporal (streaming) stores, where the CPU has them. The stores
+ *                  are fenced before returning, so the copy is visible to other cores just like an ordinary copy.
+ */
+void fcCopyStream(void* __restrict dst, const void* __restrict src, const i64 len);
+
+/**
+ * @brief           Set the size at which fcCopy() switches to streaming. < 0 means never stream.
+ */
+void fcSetStreamThreshold(const i64 bytes);
+
+/**
+ * @brief           Number of streamed copies so far, by fcCopy() or fcCopyStream(). Only a rough count if more than one thread
+ *                  is copying.
+ */
+i64 fcStreamCount();
+
+#endif /* FASTCOPY_H_ */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: FastCopyTest.c
+ *  Description:
+ *  Some very basic sanity checks for the copy kernels
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "FastCopy.h"
+
+#define FC_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+#define maxlen 1100
+#define guard 64
+
+typedef void (*copy_f)(void* __restrict dst, const void* __restrict src, const i64 len);
+
+//Copy every length that hits the different loops, from every alignment up to a cache line, and check that the bytes either
+//side of the destination are left alone
+static bool checkCopy(copy_f copy)
+{
+    bool result = true;
+    static i8 src[maxlen + guard];
+    static i8 dst[guard + maxlen + guard];
+
+    for(i64 i = 0; i < maxlen + guard; i++){
+        src[i] = i * 7 + 3;
+    }
+
+    for(i64 srcOff = 0; srcOff < guard; srcOff += 13){
+        for(i64 dstOff = 0; dstOff < guard; dstOff++){
+            for(i64 len = 0; len < maxlen; len += len < 300 ? 1 : 37){
+                memset(dst,0x5A,sizeof(dst));
+                copy(dst + guard + dstOff - guard / 2, src + srcOff, len);
+                const i8* const d = dst + guard + dstOff - guard / 2;
+                FC_ASSERT(memcmp(d, src + srcOff, len) == 0);
+                for(const i8* p = dst; p < d; p++){
+                    FC_ASSERT(*p == 0x5A);
+                }
+                for(const i8* p = d + len; p < dst + sizeof(dst); p++){
+                    FC_ASSERT(*p == 0x5A);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+//Ordinary copies
+bool test1()
+{
+    return checkCopy(fcCopyCached);
+}
+
+
+//Streaming copies
+bool test2()
+{
+    bool result = true;
+
+    const i64 streamed = fcStreamCount();
+    FC_ASSERT(checkCopy(fcCopyStream));
+    FC_ASSERT(fcStreamCount() > streamed);
+
+    return result;
+}
+
+
+//The dispatcher, with everything streamed, nothing streamed and somewhere in between
+bool test3()
+{
+    bool result = true;
+
+    fcSetStreamThreshold(0);
+    FC_ASSERT(checkCopy(fcCopy));
+    fcSetStreamThreshold(-1);
+    const i64 streamed = fcStreamCount();
+    FC_ASSERT(checkCopy(fcCopy));
+    FC_ASSERT(fcStreamCount() == streamed);
+    fcSetStreamThreshold(200);
+    FC_ASSERT(checkCopy(fcCopy));
+    fcSetStreamThreshold(FC_STREAM_THRESH_DEFAULT);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Fast Copy Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Fast Copy Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Fast Copy Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
@@ -16,6 +16,7 @@
 
 #include "utils.h"
 #include "debug.h"
+#include "FastCopy.h"
 
 
 /**
@@ -96,7 +97,7 @@ static inline llError_t newSlot(ll_t* const ll, const void* const data, i64* con
     slot->buff = (void*)(slot + 1);
     slot->seqNum = seqNum;
 
-    memcpy(slot->buff,data,toCopy);
+    fcCopy(slot->buff,data,toCopy);
 
     *len_io = toCopy;
     *slot_o = slot;
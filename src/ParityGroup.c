@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ParityGroup.c
+ *  Description:
+ *  XOR parity over a small group of blocks, enough to rebuild any single missing block of the group.
+ */
+
+#include "ParityGroup.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "debug.h"
+
+
+pgGroup_t* pgNew(const i64 maxLen)
+{
+    if(maxLen < 0){
+        return NULL;
+    }
+
+    pgGroup_t* result = calloc(1,sizeof(pgGroup_t));
+    if(!result){
+        return NULL;
+    }
+
+    result->__maxLen = maxLen;
+    result->__parity = calloc(1,maxLen + 1); //+1 so that an empty group is still a valid allocation
+    if(!result->__parity){
+        pgDelete(result);
+        return NULL;
+    }
+
+    result->groupId = -1;
+    return result;
+}
+
+
+void pgDelete(pgGroup_t* const pg)
+{
+    if(!pg){
+        return;
+    }
+
+    if(pg->__parity){
+        free(pg->__parity);
+    }
+
+    free(pg);
+}
+
+
+void pgReset(pgGroup_t* const pg, const i64 groupId)
+{
+    memset(pg->__parity,0,pg->len); //Nothing beyond len has been touched since the last reset
+    pg->groupId = groupId;
+    pg->count   = 0;
+    pg->present = 0;
+    pg->len     = 0;
+    pg->spoilt  = false;
+}
+
+
+void pgSpoil(pgGroup_t* const pg)
+{
+    pg->spoilt = true;
+}
+
+
+//Vectors are unaligned loads/stores via memcpy, which the compiler turns into single vector moves. The clones mean that
+//the widest vector unit on the CPU is picked once at load time rather than being fixed at compile time.
+typedef uint64_t pgVec_t __attribute__((vector_size(32)));
+
+#if defined(__x86_64__)
+__attribute__((target_clones("avx512f","avx2","default")))
+#endif
+void pgXor(void* __restrict dst, const void* __restrict src, const i64 len)
+{
+    i8* const d       = dst;
+    const i8* const s = src;
+    i64 i = 0;
+
+    //Unroll by 4 vectors (128B, two cache lines) to keep the load ports busy
+    for(; i + 4 * (i64)sizeof(pgVec_t) <= len; i += 4 * sizeof(pgVec_t)){
+        pgVec_t a[4];
+        pgVec_t b[4];
+        memcpy(a, d + i, sizeof(a));
+        memcpy(b, s + i, sizeof(b));
+        a[0] ^= b[0];
+        a[1] ^= b[1];
+        a[2] ^= b[2];
+        a[3] ^= b[3];
+        memcpy(d + i, a, sizeof(a));
+    }
+
+    for(; i + (i64)sizeof(pgVec_t) <= len; i += sizeof(pgVec_t)){
+        pgVec_t a;
+        pgVec_t b;
+        memcpy(&a, d + i, sizeof(a));
+        memcpy(&b, s + i, sizeof(b));
+        a ^= b;
+        memcpy(d + i, &a, sizeof(a));
+    }
+
+    for(; i + (i64)sizeof(uint64_t) <= len; i += sizeof(uint64_t)){
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, d + i, sizeof(a));
+        memcpy(&b, s + i, sizeof(b));
+        a ^= b;
+        memcpy(d + i, &a, sizeof(a));
+    }
+
+    for(; i < len; i++){
+        d[i] ^= s[i];
+    }
+}
+
+
+pgError_t pgAdd(pgGroup_t* const pg, const i64 idx, const void* const hdr, const i64 hdrLen, const void* const body, const i64 bodyLen)
+{
+    if_unlikely(idx < 0 || idx >= PG_MAX_GROUP){
+        return pgERANGE;
+    }
+
+    const uint64_t bit = 1ULL << idx;
+    if_unlikely(pg->present & bit){
+        return pgEALREADY; //Duplicate (eg a retransmit), collecting it again would cancel it out
+    }
+
+    const i64 len = hdrLen + bodyLen;
+    if_unlikely(len > pg->__maxLen){
+        return pgETOOBIG;
+    }
+
+    pgXor(pg->__parity, hdr, hdrLen);
+    pgXor(pg->__parity + hdrLen, body, bodyLen);
+
+    pg->present |= bit;
+    pg->count++;
+    pg->len = len > pg->len ? len : pg->len;
+
+    return pgENOERR;
+}
+
+
+pgError_t pgRebuild(pgGroup_t* const pg, const i64 groupSize, const void* const parity, const i64 len, void* const block_o, i64* const idx_o)
+{
+    if_unlikely(groupSize <= 1 || groupSize > PG_MAX_GROUP){
+        return pgERANGE;
+    }
+
+    if_unlikely(len > pg->__maxLen){
+        return pgETOOBIG;
+    }
+
+    if_eqlikely(pg->count != groupSize - 1 || pg->spoilt){
+        return pgENOREBUILD; //Either nothing is missing, or too much is, or what we have doesn't match the parity
+    }
+
+    if_unlikely(pg->len > len){
+        return pgENOREBUILD; //The parity is shorter than something we collected, so it can't be for this group
+    }
+
+    const uint64_t groupMask = groupSize == PG_MAX_GROUP ? ~0ULL : (1ULL << groupSize) - 1;
+    const uint64_t missing   = ~pg->present & groupMask;
+    if_unlikely(missing == 0){
+        return pgENOREBUILD;
+    }
+    const i64 idx = __builtin_ctzll(missing);
+
+    memcpy(block_o, parity, len);
+    pgXor(block_o, pg->__parity, pg->len);
+
+    //The rebuilt block counts as collected now, so a late copy of it is recognised as a duplicate
+    pgXor(pg->__parity, block_o, len);
+    pg->present |= 1ULL << idx;
+    pg->count++;
+    pg->len = len;
+
+    *idx_o = idx;
+    return pgENOERR;
+}
+
+
+static char* errors[pgECOUNT] = {
+    "Success! No error",                    //pgENOERR
+    "No memory available",                  //pgENOMEM
+    "Block index is out of range",          //pgERANGE
+    "Block is too big for the group",       //pgETOOBIG
+    "Block has already been collected",     //pgEALREADY
+    "Not exactly one block missing",        //pgENOREBUILD
+};
+
+
+//Convert a pgError number into a text description
+const char* pgError2Str(const pgError_t err)
+{
+    if(err >= pgECOUNT){
+        return "Bad error number";
+    }
+
+    return errors[err];
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ParityGroup.h
+ *  Description:
+ *  XOR parity over a small group of blocks, enough to rebuild any single missing block of the group.
+ */
+#ifndef PARITYGROUP_H_
+#define PARITYGROUP_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * A parity group collects the XOR of up to 64 blocks. Blocks can be different lengths, shorter blocks are treated as if they
+ * were zero padded out to the longest one. Each block has an index in the group (0-63) so that the group can tell which
+ * blocks it has seen and which one is missing.
+ *
+ * Given the parity of the whole group (from somewhere else), if exactly one block is missing from the group, it is
+ *
+ *      missing = parity ^ block[0] ^ ... ^ block[n-1]  (excluding the missing one)
+ *
+ * which is exactly what the group has collected, XOR'd with the parity.
+ */
+
+#define PG_MAX_GROUP_LOG2 (6) //The present blocks are tracked in a 64bit mask
+#define PG_MAX_GROUP (1LL << PG_MAX_GROUP_LOG2)
+
+typedef struct {
+    i64 groupId;      //The group being collected, -1 if the group is not in use
+    i64 count;        //Number of blocks collected so far
+    uint64_t present; //Bit i is set if block i has been collected
+    i64 len;          //Length of the parity so far, which is the length of the longest block collected
+    bool spoilt;      //A block will never be collected as it was when the parity was made, so nothing can be rebuilt, see pgSpoil()
+
+    //__itmes are "private"
+    i64 __maxLen;     //Largest block that can be collected
+    i8* __parity;     //XOR of all blocks collected so far
+} pgGroup_t;
+
+
+/**
+ * @brief Errors returned by the parity group structure
+ */
+typedef enum {
+    pgENOERR = 0,   //!< pgENOERR       Success!
+    pgENOMEM,       //!< pgENOMEM       Ran out of memory
+    pgERANGE,       //!< pgERANGE       Block index is out of range for the group
+    pgETOOBIG,      //!< pgETOOBIG      Block is too big for the group
+    pgEALREADY,     //!< pgEALREADY     Block has already been collected, it was not collected again
+    pgENOREBUILD,   //!< pgENOREBUILD   Cannot rebuild, the group is not missing exactly one block
+
+    //THIS MUST BE LAST
+    pgECOUNT,       //!< pgECOUNT       Total number of error codes.
+} pgError_t;
+
+
+/**
+ * @brief           Create a new parity group
+ * @param maxLen    The longest block that the group will need to collect
+ * @return          On success a new a pointer to a new pgGroup_t structure. On failure, NULL will be returned
+ */
+pgGroup_t* pgNew(const i64 maxLen);
+
+/**
+ * Free memory resoruces associated with this parity group
+ * @param pg
+ */
+void pgDelete(pgGroup_t* const pg);
+
+/**
+ * @brief           Throw away everything collected so far and start collecting a new group
+ * @param pg        The parity group that we're operating on
+ * @param groupId   Id for the new group, -1 for not in use
+ */
+void pgReset(pgGroup_t* const pg, const i64 groupId);
+
+/**
+ * @brief           Collect a block into the group. A block is made of two parts (a header and a body) which are treated as
+ *                  if they were one contiguous block. Either part may be empty.
+ * @param pg        The parity group that we're operating on
+ * @param idx       Index of the block in the group
+ * @return          ENOERROR - the block has been collected
+ *                  EALREADY - the block had already been collected, nothing has changed
+ *                  ERANGE   - idx is out of range
+ *                  ETOOBIG  - the block is longer than the group can take
+ */
+pgError_t pgAdd(pgGroup_t* const pg, const i64 idx, const void* const hdr, const i64 hdrLen, const void* const body, const i64 bodyLen);
+
+/**
+ * @brief           A block of the group will never turn up as it was when the parity was made (eg the sender changed it
+ *                  afterwards), so the group can't rebuild anything. Collecting carries on, but pgRebuild() will always
+ *                  say ENOREBUILD until the next pgReset().
+ * @param pg        The parity group that we're operating on
+ */
+void pgSpoil(pgGroup_t* const pg);
+
+/**
+ * @brief           Rebuild the single missing block of a group from the parity of the whole group.
+ * @param pg        The parity group that we're operating on
+ * @param groupSize The number of blocks in the whole group
+ * @param parity    Parity of the whole group
+ * @param len       Length of the parity
+ * @param block_o   At least len bytes, the rebuilt block is put here. Bytes beyond the end of the block will be zero.
+ * @param idx_o     The index of the rebuilt block
+ * @return          ENOERROR  - block_o and idx_o are valid, the block is now also counted as collected
+ *                  ENOREBUILD - the group is not missing exactly one block, or is spoilt, nothing to do
+ *                  ETOOBIG   - the parity is longer than the group can take
+ */
+pgError_t pgRebuild(pgGroup_t* const pg, const i64 groupSize, const void* const parity, const i64 len, void* const block_o, i64* const idx_o);
+
+/**
+ * @brief           dst ^= src for len bytes. Uses the widest vectors the CPU has (chosen at load time).
+ */
+void pgXor(void* __restrict dst, const void* __restrict src, const i64 len);
+
+//Convert a pgError number into a text description
+const char* pgError2Str(pgError_t const err);
+
+#endif /* PARITYGROUP_H_ */
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: ParityGroupTest.c
+ *  Description:
+ *  Some very basic sanity checks for the parity group structure
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ParityGroup.h"
+
+#define PG_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+//Basic test allocate and free, should pass the valgrind and addresssanitizer checks
+bool test1()
+{
+    bool result = true;
+    pgGroup_t* pg = pgNew(17);
+    PG_ASSERT(pg != NULL);
+    PG_ASSERT(pg->groupId == -1);
+    pgDelete(pg);
+    return result;
+}
+
+
+//Check the xor kernel against a byte at a time version, over all of the lengths that hit the different loops
+bool test2()
+{
+    bool result = true;
+    i8 a[300];
+    i8 b[300];
+    i8 c[300];
+
+    for(i64 len = 0; len < 300; len++){
+        for(i64 i = 0; i < 300; i++){
+            a[i] = i * 7 + len;
+            b[i] = i * 13 + 1;
+            c[i] = i < len ? a[i] ^ b[i] : a[i];
+        }
+        pgXor(a,b,len);
+        PG_ASSERT(memcmp(a,c,sizeof(a)) == 0);
+    }
+
+    return result;
+}
+
+
+//Collect all but one block of different lengths, then rebuild the missing one from the parity
+bool test3()
+{
+    #define blocks 8
+    #define maxlen 100
+    bool result = true;
+    pgError_t err = pgENOERR;
+    i8 data[blocks][maxlen] = {{0}};
+    i64 lens[blocks];
+    i8 parity[maxlen] = {0};
+
+    pgGroup_t* pg = pgNew(maxlen);
+    PG_ASSERT(pg != NULL);
+
+    for(i64 missing = 0; missing < blocks; missing++){
+        pgReset(pg,missing);
+        memset(parity,0,sizeof(parity));
+        for(i64 i = 0; i < blocks; i++){
+            lens[i] = 10 + i * 11;
+            for(i64 j = 0; j < lens[i]; j++){
+                data[i][j] = i * 31 + j + missing;
+            }
+            pgXor(parity,data[i],lens[i]);
+        }
+
+        for(i64 i = 0; i < blocks; i++){
+            if(i == missing){
+                continue;
+            }
+            //Split each block into a header and a body, it should make no difference
+            err = pgAdd(pg,i,data[i],4,data[i] + 4,lens[i] - 4);
+            PG_ASSERT(err == pgENOERR);
+        }
+
+        //A duplicate should not be collected again
+        err = pgAdd(pg,(missing + 1) % blocks,data[(missing + 1) % blocks],lens[(missing + 1) % blocks],NULL,0);
+        PG_ASSERT(err == pgEALREADY);
+        PG_ASSERT(pg->count == blocks - 1);
+
+        i8 rebuilt[maxlen];
+        i64 idx = -1;
+        err = pgRebuild(pg,blocks,parity,maxlen,rebuilt,&idx);
+        PG_ASSERT(err == pgENOERR);
+        PG_ASSERT(idx == missing);
+        PG_ASSERT(memcmp(rebuilt,data[missing],lens[missing]) == 0);
+        for(i64 j = lens[missing]; j < maxlen; j++){
+            PG_ASSERT(rebuilt[j] == 0);
+        }
+
+        //Now that it's rebuilt, there is nothing missing
+        err = pgRebuild(pg,blocks,parity,maxlen,rebuilt,&idx);
+        PG_ASSERT(err == pgENOREBUILD);
+        err = pgAdd(pg,missing,data[missing],lens[missing],NULL,0);
+        PG_ASSERT(err == pgEALREADY);
+    }
+
+    pgDelete(pg);
+    return result;
+}
+
+
+//Rebuilding needs exactly one block missing, and blocks need to fit
+bool test4()
+{
+    bool result = true;
+    pgError_t err = pgENOERR;
+    i8 data[16] = {0};
+    i8 rebuilt[16];
+    i64 idx = -1;
+
+    pgGroup_t* pg = pgNew(8);
+    PG_ASSERT(pg != NULL);
+    pgReset(pg,0);
+
+    err = pgAdd(pg,0,data,16,NULL,0);
+    PG_ASSERT(err == pgETOOBIG);
+    err = pgAdd(pg,PG_MAX_GROUP,data,8,NULL,0);
+    PG_ASSERT(err == pgERANGE);
+
+    err = pgAdd(pg,0,data,8,NULL,0);
+    PG_ASSERT(err == pgENOERR);
+    err = pgRebuild(pg,4,data,8,rebuilt,&idx);
+    PG_ASSERT(err == pgENOREBUILD); //3 missing
+
+    err = pgAdd(pg,1,data,8,NULL,0);
+    PG_ASSERT(err == pgENOERR);
+    err = pgAdd(pg,2,data,8,NULL,0);
+    PG_ASSERT(err == pgENOERR);
+    err = pgRebuild(pg,4,data,8,rebuilt,&idx);
+    PG_ASSERT(err == pgENOERR);
+    PG_ASSERT(idx == 3);
+
+    //A spoilt group never rebuilds, until it is reset
+    pgReset(pg,1);
+    for(i64 i = 0; i < 3; i++){
+        err = pgAdd(pg,i,data,8,NULL,0);
+        PG_ASSERT(err == pgENOERR);
+    }
+    pgSpoil(pg);
+    err = pgRebuild(pg,4,data,8,rebuilt,&idx);
+    PG_ASSERT(err == pgENOREBUILD);
+    pgReset(pg,2);
+    PG_ASSERT(!pg->spoilt);
+
+    pgDelete(pg);
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Parity Group Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Parity Group Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Parity Group Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Parity Group Test 04: ");  printf("%s", (test_pass = test4()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
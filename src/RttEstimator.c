@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: RttEstimator.c
+ *  Description:
+ *  Round trip time estimates for a connection, built up one ack'd packet at a time.
+ */
+
+#include "RttEstimator.h"
+#include <string.h>
+
+#include "utils.h"
+#include "debug.h"
+
+
+void rttReset(rttEst_t* const est, const i64 winNs)
+{
+    memset(est,0,sizeof(rttEst_t));
+    est->__winNs = winNs;
+}
+
+
+//Start the window over with just this sample in it
+static inline void rttWinReset(rttWinSample_t* const win, const rttWinSample_t sample)
+{
+    win[0] = sample;
+    win[1] = sample;
+    win[2] = sample;
+}
+
+
+//Put a sample into a windowed filter. win[0] is the best sample in the window, win[1] the best since win[0], and win[2] the
+//best since win[1]. "better" says if a sample is at least as good as another, which makes this a min or a max filter.
+static inline i64 rttWinUpdate(rttWinSample_t* const win, const i64 winNs, const rttWinSample_t sample, const bool isMax)
+{
+    #define BETTER(a,b) (isMax ? (a) >= (b) : (a) <= (b))
+
+    //A new best, or nothing in the window is recent enough to keep, start again
+    if_unlikely(BETTER(sample.rttNs, win[0].rttNs) || sample.timeNs - win[2].timeNs > winNs){
+        rttWinReset(win,sample);
+        return win[0].rttNs;
+    }
+
+    if_unlikely(BETTER(sample.rttNs, win[1].rttNs)){
+        win[1] = sample;
+        win[2] = sample;
+    }
+    else if_unlikely(BETTER(sample.rttNs, win[2].rttNs)){
+        win[2] = sample;
+    }
+    #undef BETTER
+
+    //The best has aged out of the window, move everything up. The second best may have aged out too.
+    const i64 age = sample.timeNs - win[0].timeNs;
+    if_unlikely(age > winNs){
+        win[0] = win[1];
+        win[1] = win[2];
+        win[2] = sample;
+        if_unlikely(sample.timeNs - win[0].timeNs > winNs){
+            win[0] = win[1];
+            win[1] = win[2];
+            win[2] = sample;
+        }
+    }
+    //Without a new second (or third) best, they would all stay as old as the best. Keep them coming from later parts of the
+    //window, so that there is something fresh to fall back on when the best ages out.
+    else if_unlikely(win[1].timeNs == win[0].timeNs && age > winNs / 4){
+        win[1] = sample;
+        win[2] = sample;
+    }
+    else if_unlikely(win[2].timeNs == win[1].timeNs && age > winNs / 2){
+        win[2] = sample;
+    }
+
+    return win[0].rttNs;
+}
+
+
+void rttSample(rttEst_t* const est, const i64 rttNs, const i64 timeNowNs)
+{
+    if_unlikely(rttNs < 0){
+        DBG("Ignoring negative RTT sample %lins\n", rttNs);
+        return;
+    }
+
+    const rttWinSample_t sample = { .timeNs = timeNowNs, .rttNs = rttNs };
+    est->lastNs = rttNs;
+
+    //The first sample is all that there is to go on, assume that the variation is large (RFC 6298)
+    if_unlikely(est->samples == 0){
+        est->srttNs   = rttNs;
+        est->rttVarNs = rttNs / 2;
+        rttWinReset(est->__min,sample);
+        rttWinReset(est->__max,sample);
+    }
+    else{
+        const i64 err = rttNs - est->srttNs;
+        est->rttVarNs += ((err < 0 ? -err : err) - est->rttVarNs) / 4;
+        est->srttNs   += err / 8;
+    }
+
+    est->samples++;
+    est->rtoNs = est->srttNs + 4 * est->rttVarNs;
+    est->minNs = rttWinUpdate(est->__min,est->__winNs,sample,false);
+    est->maxNs = rttWinUpdate(est->__max,est->__winNs,sample,true);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: RttEstimator.h
+ *  Description:
+ *  Round trip time estimates for a connection, built up one ack'd packet at a time.
+ */
+#ifndef RTTESTIMATOR_H_
+#define RTTESTIMATOR_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/*
+ * The estimator takes one RTT sample at a time, and keeps:
+ *  - A smoothed RTT and the mean deviation from it, with the usual TCP gains (1/8 and 1/4, see RFC 6298). These give a
+ *    retransmit timeout of srtt + 4 * rttVar.
+ *  - The min and max RTT over a sliding time window. These use Kathleen Nichols' windowed filter (the one in Linux and BBR),
+ *    which keeps the best three samples from different parts of the window rather than every sample. It is O(1) per sample
+ *    and always gives back a sample from inside the window, but a sample that drops out of the window may be replaced by
+ *    the best from the most recent quarter or half of it, rather than the exact best of the rest.
+ *
+ * The caller decides what is a good sample. In particular, a packet that was sent more than once gives an ambiguous sample
+ * (which send is being ack'd?) and should not be given to the estimator at all (Karn's algorithm).
+ */
+
+typedef struct {
+    i64 timeNs;
+    i64 rttNs;
+} rttWinSample_t;
+
+typedef struct {
+    i64 samples;  //Number of samples so far. Nothing below is valid until there is at least one
+    i64 lastNs;   //The latest sample
+    i64 srttNs;   //Smoothed RTT
+    i64 rttVarNs; //Mean deviation of the samples from srttNs
+    i64 rtoNs;    //srttNs + 4 * rttVarNs. The TC may want to put a floor under this
+    i64 minNs;    //Lowest sample in the window
+    i64 maxNs;    //Highest sample in the window
+
+    //__itmes are "private"
+    i64 __winNs;
+    rttWinSample_t __min[3];
+    rttWinSample_t __max[3];
+} rttEst_t;
+
+
+/**
+ * @brief           Forget all samples. The estimator is a plain structure, so this is also how to initialise one.
+ * @param est       The estimator we're operating on
+ * @param winNs     How far back the min and max RTT look
+ */
+void rttReset(rttEst_t* const est, const i64 winNs);
+
+/**
+ * @brief           Take a new sample
+ * @param est       The estimator we're operating on
+ * @param rttNs     The round trip time measured. Negative samples (clocks going backwards) are ignored
+ * @param timeNowNs When the sample was taken, for the min/max window. This should not go backwards
+ */
+void rttSample(rttEst_t* const est, const i64 rttNs, const i64 timeNowNs);
+
+#endif /* RTTESTIMATOR_H_ */
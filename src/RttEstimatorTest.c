@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: RttEstimatorTest.c
+ *  Description:
+ *  Some very basic sanity checks for the RTT estimator
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "RttEstimator.h"
+
+#define RTT_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+//The first sample sets everything, a steady RTT after that settles the variation down to nothing
+bool test1()
+{
+    bool result = true;
+    rttEst_t est;
+    rttReset(&est,1000);
+    RTT_ASSERT(est.samples == 0);
+
+    rttSample(&est,-5,0);
+    RTT_ASSERT(est.samples == 0);
+
+    rttSample(&est,800,0);
+    RTT_ASSERT(est.samples == 1);
+    RTT_ASSERT(est.srttNs == 800);
+    RTT_ASSERT(est.rttVarNs == 400);
+    RTT_ASSERT(est.rtoNs == 800 + 4 * 400);
+    RTT_ASSERT(est.minNs == 800 && est.maxNs == 800);
+
+    for(i64 i = 1; i < 100; i++){
+        rttSample(&est,800,i);
+    }
+    RTT_ASSERT(est.samples == 100);
+    RTT_ASSERT(est.srttNs == 800);
+    RTT_ASSERT(est.rttVarNs < 4);
+    RTT_ASSERT(est.lastNs == 800);
+
+    return result;
+}
+
+
+//A step change in RTT moves the smoothed RTT over to it, and shows up in the variation on the way
+bool test2()
+{
+    bool result = true;
+    rttEst_t est;
+    rttReset(&est,1000);
+
+    for(i64 i = 0; i < 100; i++){
+        rttSample(&est,1000,i);
+    }
+    rttSample(&est,2000,100);
+    RTT_ASSERT(est.srttNs == 1000 + 1000 / 8);
+    RTT_ASSERT(est.rttVarNs >= 1000 / 4);
+    RTT_ASSERT(est.rtoNs > 2000);
+
+    for(i64 i = 101; i < 300; i++){
+        rttSample(&est,2000,i);
+    }
+    RTT_ASSERT(est.srttNs > 1990 && est.srttNs <= 2000);
+
+    return result;
+}
+
+
+//A spike (or a dip) is remembered for the length of the window and no longer
+bool test3()
+{
+    bool result = true;
+    const i64 win = 100;
+    rttEst_t est;
+    rttReset(&est,win);
+
+    for(i64 t = 0; t < 50; t++){
+        rttSample(&est,t == 10 ? 500 : t == 20 ? 10 : 100,t);
+    }
+    RTT_ASSERT(est.maxNs == 500);
+    RTT_ASSERT(est.minNs == 10);
+
+    for(i64 t = 50; t <= 10 + win; t++){
+        rttSample(&est,100,t);
+        RTT_ASSERT(est.maxNs == 500);
+    }
+    rttSample(&est,100,11 + win);
+    RTT_ASSERT(est.maxNs == 100);
+    RTT_ASSERT(est.minNs == 10);
+
+    for(i64 t = 12 + win; t <= 21 + win; t++){
+        rttSample(&est,100,t);
+    }
+    RTT_ASSERT(est.minNs == 100);
+
+    return result;
+}
+
+
+//On random samples, the min and max are always one of the samples from inside the window, and they bound the latest one
+bool test4()
+{
+    bool result = true;
+    const i64 win   = 1000;
+    const i64 count = 20000;
+    srand(17);
+    i64* times = calloc(count,sizeof(i64));
+    i64* rtts  = calloc(count,sizeof(i64));
+    RTT_ASSERT(times != NULL && rtts != NULL);
+
+    rttEst_t est;
+    rttReset(&est,win);
+    i64 t = 0;
+    for(i64 i = 0; i < count; i++){
+        t += rand() % 50;
+        times[i] = t;
+        rtts[i]  = 1000 + rand() % 1000;
+        rttSample(&est,rtts[i],t);
+
+        RTT_ASSERT(est.minNs <= rtts[i] && rtts[i] <= est.maxNs);
+        bool minFound = false;
+        bool maxFound = false;
+        for(i64 j = i; j >= 0 && t - times[j] <= win; j--){
+            minFound = minFound || rtts[j] == est.minNs;
+            maxFound = maxFound || rtts[j] == est.maxNs;
+        }
+        RTT_ASSERT(minFound && maxFound);
+    }
+
+    free(times);
+    free(rtts);
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: RTT Estimator Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: RTT Estimator Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: RTT Estimator Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: RTT Estimator Test 04: ");  printf("%s", (test_pass = test4()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
@@ -22,6 +22,8 @@
 #include <arpa/inet.h>
 
 #include "CircularQueue.h"
+#include "FastCopy.h"
+#include "Bitmap.h"
 #include "types.h"
 #include "spooky_hash.h"
 #include "debug.h"
@@ -31,9 +33,91 @@
 #include "etcp.h"
 
 #include "etcpState.h"
+#include "etcpTcStatic.h"
 #include "etcpSockApi.h"
 
 
+//pBuffs are copied whole (header followed by frame) into queue slots. Move the pointers in the copy across to its own frame.
+static inline void etcpPBuffRebase(pBuff_t* const copy, const pBuff_t* const orig)
+{
+    const i8* const origBase = orig->buffer;
+    i8* const copyBase       = (i8*)(copy + 1);
+    copy->buffer      = copyBase;
+    copy->encapHdr    = copyBase + ((i8*)orig->encapHdr   - origBase);
+    copy->etcpHdr     = (etcpMsgHead_t*)(copyBase + ((i8*)orig->etcpHdr - origBase));
+    copy->etcpPayHdr  = copyBase + ((i8*)orig->etcpPayHdr - origBase);
+    copy->etcpPayload = orig->etcpPayload ? copyBase + ((i8*)orig->etcpPayload - origBase) : NULL;
+}
+
+
+//The parts of a data header that parity covers
+static inline etcpFecDatSummary_t etcpFecSummary(const etcpMsgDatHdr_t* const datHdr)
+{
+    const etcpFecDatSummary_t summary = {
+        .datLen    = datHdr->datLen,
+        .noAck     = datHdr->noAck,
+        .noRet     = datHdr->noRet,
+        .skipDat   = datHdr->skipDat,
+        .streamId  = datHdr->streamId,
+        .streamSeq = datHdr->streamSeq,
+    };
+    return summary;
+}
+
+
+//Collect a newly received data packet into the parity for its group, so that if another packet from the group goes missing
+//it can be rebuilt when the parity arrives.
+static inline void etcpFecOnRxDat(etcpConn_t* const recvConn, const etcpMsgDatHdr_t* const datHdr)
+{
+    if_unlikely(recvConn->fecLog2 != datHdr->fecLog2){
+        //The sender has turned FEC on (or changed the group size), follow along
+        DBG("Sender changed FEC group size from 2^%li to 2^%li\n", recvConn->fecLog2, datHdr->fecLog2);
+        if_unlikely(etcpConnFec(recvConn,datHdr->fecLog2) != etcpENOERR){
+            WARN("Could not set up FEC with group size 2^%li\n", datHdr->fecLog2);
+            return;
+        }
+    }
+
+    const i64 groupId   = datHdr->seqNum >> recvConn->fecLog2;
+    pgGroup_t* const pg = recvConn->fecRx[groupId & (ETCP_FEC_RX_GROUPS - 1)];
+    if_unlikely(pg->groupId > groupId){
+        return; //A late packet from a group we've already given up on
+    }
+    if_unlikely(pg->groupId < groupId){
+        pgReset(pg,groupId);
+    }
+
+    //A skip marker may have replaced a packet after it went into the sender's parity, so it can't be used to rebuild
+    //anything else in the group. The sender leaves skip markers out of the parity, see etcpFecOnTxDat().
+    if_unlikely(datHdr->skipDat){
+        pgSpoil(pg);
+        return;
+    }
+
+    const etcpFecDatSummary_t summary = etcpFecSummary(datHdr);
+    const i64 idx = datHdr->seqNum & ((1LL << recvConn->fecLog2) - 1);
+    const pgError_t err = pgAdd(pg,idx,&summary,sizeof(summary),datHdr + 1,datHdr->datLen);
+    if_unlikely(err != pgENOERR && err != pgEALREADY){
+        WARN("Could not add seq %li to parity group: %s\n", datHdr->seqNum, pgError2Str(err));
+    }
+}
+
+
+//Release a slot in the receive window. The ack bitmaps keep the bits for released slots until the read pointer moves past
+//them, so that a slot released out of order still counts as received. Once the slots are out of the window, the bits are
+//cleared ready for the sequence numbers that will use them next time around.
+static inline cqError_t etcpRxRelease(etcpConn_t* const conn, const i64 seq)
+{
+    const i64 rdMinBefore = conn->rxQ->rdMin;
+    const cqError_t err = cqReleaseSlot(conn->rxQ,seq);
+    if_likely(conn->rxQ->rdMin > rdMinBefore){
+        bmClearRange(conn->rxRcvd,rdMinBefore,conn->rxQ->rdMin - rdMinBefore);
+        bmClearRange(conn->rxAcked,rdMinBefore,conn->rxQ->rdMin - rdMinBefore);
+    }
+    return err;
+}
+
+
 static inline etcpError_t etcpOnRxDat(etcpState_t* const state, pBuff_t* const pbuff, const etcpFlowId_t* const flowId)
 {
     //DBG("Working on new data message with type = 0x%016x\n", head->type);
@@ -44,7 +128,9 @@ static inline etcpError_t etcpOnRxDat(etcpState_t* const state, pBuff_t* const p
         WARN("Not enough bytes to parse data header, required %li but got %li\n", minSizeDatHdr, msgSpace);
         return etcpEBADPKT; //Bad packet, not enough data in it
     }
-    etcpMsgDatHdr_t* const datHdr = (etcpMsgDatHdr_t* const)(pbuff->etcpDatHdr + 1);
+    etcpMsgDatHdr_t* const datHdr = (etcpMsgDatHdr_t* const)(pbuff->etcpHdr + 1);
+    pbuff->etcpDatHdr             = datHdr;
+    pbuff->etcpDatHdrSize         = minSizeDatHdr;
     //DBG("Working on new data message with seq = 0x%016x\n", datHdr->seqNum);
 
     //Got a valid data header, more sanity checking
@@ -82,6 +168,11 @@ static inline etcpError_t etcpOnRxDat(etcpState_t* const state, pBuff_t* const p
     }
 
     //By this point, the connection structure should be properly populated one way or antoher
+    //Urgent packets live in their own lane with their own sequence space, from here on they are treated just the same
+    if_unlikely(datHdr->urgent){
+        recvConn = recvConn->urgent;
+    }
+
     const i64 seqPkt        = datHdr->seqNum;
     const i64 seqMin        = recvConn->rxQ->rdMin; //The very minimum sequence number that we will consider
     const i64 seqMax        = recvConn->rxQ->wrMax; //One greater than the biggest seq we can handle
@@ -95,12 +186,34 @@ static inline etcpError_t etcpOnRxDat(etcpState_t* const state, pBuff_t* const p
     //-- if seq >= seqMax, it is beyond the end of the rx window, ignore it, the packet will be sent again
     //-- if seq < seqMin, it has already been ack'd, the ack must have got lost, send another ack
     if_unlikely(seqPkt >= seqMax){
-        FAT("Ignoring packet, seqPkt %li >= %li seqMax, packet will not fit in window\n", seqPkt, seqMax);
+        WARN("Ignoring packet, seqPkt %li >= %li seqMax, packet will not fit in window\n", seqPkt, seqMax);
         return etcpERANGE;
     }
 
-    if_unlikely(seqPkt < seqMin){
-        WARN("Stale packet, seqPkt %li < %li seqMin, packet has already been ack'd\n", seqPkt, seqMin);
+    //Delivery to the user is ordered per stream. Packets that have already been delivered on their stream can also be
+    //released from the connection window out of order, so check for staleness against the stream as well.
+    if_unlikely((i64)datHdr->streamId >= ETCP_MAX_STREAMS){
+        WARN("Stream id %li is out of range, max is %li\n", (i64)datHdr->streamId, ETCP_MAX_STREAMS - 1);
+        return etcpEBADPKT;
+    }
+    etcpStream_t* const stream = recvConn->streams[datHdr->streamId];
+    if_unlikely(stream == NULL){
+        WARN("Ignoring packet for stream %li, which has not been opened here\n", (i64)datHdr->streamId);
+        return etcpEBADPKT;
+    }
+    const i64 streamSeqPkt = datHdr->streamSeq;
+    const i64 streamSeqMin = stream->rxQ->rdMin;
+
+    if_unlikely(seqPkt < seqMin || streamSeqPkt < streamSeqMin){
+        //The second copy of a redundantly sent packet is expected, and its twin has already been ack'd. A retransmission
+        //(txAttempts > 0) could be the sender chasing a lost ack though, so those still go the slow way below.
+        if_likely(datHdr->dupTx && datHdr->txAttempts == 0){
+            recvConn->rxDups++;
+            return etcpENOERR;
+        }
+
+        WARN("Stale packet, seqPkt %li < %li seqMin or streamSeqPkt %li < %li streamSeqMin, packet has already been ack'd\n",
+                seqPkt, seqMin, streamSeqPkt, streamSeqMin);
 
         if_eqlikely(datHdr->noAck){
             //This packet does not want an ack, and it's stale, so just ignore it
@@ -127,9 +240,22 @@ static inline etcpError_t etcpOnRxDat(etcpState_t* const state, pBuff_t* const p
 
     }
 
+    //First copy wins. Anything else with the same sequence number is a duplicate (from redundant transmission, or a
+    //retransmission that crossed with the ack) and is already here, waiting to be ack'd and/or delivered.
+    cqSlot_t* slot = NULL;
+    cqError_t err = cqGet(recvConn->rxQ,&slot,seqPkt);
+    if_unlikely(err != cqENOERR){
+        WARN("Error getting slot from Circular Queue: %s", cqError2Str(err));
+        return etcpECQERR;
+    }
+    if_unlikely(slot->valid || bmGet(recvConn->rxRcvd,seqPkt)){
+        recvConn->rxDups++;
+        return etcpENOERR;
+    }
+
     const i64 toCopy = pbuff->buffSize + sizeof(pBuff_t); //Include the size of pbuff header so that we can copy the whole thing
     i64 toCopyTmp = toCopy;
-    cqError_t err = cqPush(recvConn->rxQ,pbuff,&toCopyTmp,seqPkt);
+    err = cqPush(recvConn->rxQ,pbuff,&toCopyTmp,seqPkt);
 
     if_unlikely(err == cqENOSLOT){
         WARN("Unexpected state, packet not enough space in queue\n");
@@ -143,62 +269,256 @@ static inline etcpError_t etcpOnRxDat(etcpState_t* const state, pBuff_t* const p
         return etcpECQERR;
     }
 
+    //The copy still points at the frame it came from (which is about to be reused), point it at its own frame instead
+    etcpPBuffRebase(slot->buff,pbuff);
+
     cqCommitSlot(recvConn->rxQ,seqPkt,toCopyTmp);
 
+    //Finally, put the packet into stream order so that it can be delivered
+    i64 idxLen = sizeof(seqPkt);
+    err = cqPush(stream->rxQ,&seqPkt,&idxLen,streamSeqPkt);
+    if_unlikely(err != cqENOERR){
+        WARN("Could not put seq %li into stream %li receive queue: %s\n", seqPkt, datHdr->streamId, cqError2Str(err));
+        etcpRxRelease(recvConn,seqPkt); //Pretend we never got it, it will be sent again
+        return etcpECQERR;
+    }
+    cqCommitSlot(stream->rxQ,streamSeqPkt,idxLen);
+
+    //Ready to be ack'd. Packets that don't want an ack count as ack'd already so that they can be delivered straight away
+    bmSet(recvConn->rxRcvd,seqPkt);
+    recvConn->rxSeqHi = MAX(recvConn->rxSeqHi, seqPkt + 1);
+    if_eqlikely(datHdr->noAck){
+        bmSet(recvConn->rxAcked,seqPkt);
+    }
+    else{
+        recvConn->ackWaitingNs = recvConn->ackWaiting == 0 ? (i64)pbuff->etcpHdr->ts.swRxTimeNs : recvConn->ackWaitingNs;
+        recvConn->ackWaiting++;
+        recvConn->ackNowReq   |= datHdr->ackNow;
+    }
+
+    if_unlikely(datHdr->fecLog2 != 0){
+        etcpFecOnRxDat(recvConn,datHdr);
+    }
+
     return etcpENOERR;
 }
 
-static inline  etcpError_t etcpProcessAck(cq_t* const cq, const uint64_t seq, const etcpTime_t* const ackTime, const etcpTime_t* const datFirstTime, const etcpTime_t* const datLastTime)
+
+//A parity packet has arrived. If exactly one packet from its group is missing, rebuild it and receive it as if it had just
+//arrived off the wire.
+static inline etcpError_t etcpOnRxFec(etcpState_t* const state, pBuff_t* const pbuff, const etcpFlowId_t* const flowId)
 {
-    //DBG("Processing ack for seq=%li\n", seq);
-    if(seq < (uint64_t)cq->rdMin){
-        WARN("Stale ack, this ack has already been accepted\n");
-        return etcpENOERR;
+    const i64 minSizeFecHdr = sizeof(etcpMsgFecHdr_t);
+    const i64 msgSpace = pbuff->msgSize - pbuff->encapHdrSize - pbuff->etcpHdrSize;
+    if_unlikely(msgSpace < minSizeFecHdr){
+        WARN("Not enough bytes to parse parity header, required %li but got %li\n", minSizeFecHdr, msgSpace);
+        return etcpEBADPKT; //Bad packet, not enough data in it
     }
 
-    cqSlot_t* slot = NULL;
-    const cqError_t err = cqGetRd(cq,&slot,seq);
-    if_unlikely(err != cqENOERR){
-        WARN("Error getting value from Circular Queue: %s", cqError2Str(err));
-        return etcpECQERR;
+    const etcpMsgFecHdr_t* const fecHdr = (const etcpMsgFecHdr_t* const)(pbuff->etcpHdr + 1);
+    const i64 parityLen = msgSpace - minSizeFecHdr;
+    if_unlikely(parityLen != fecHdr->parityLen || parityLen < (i64)sizeof(etcpFecDatSummary_t)){
+        WARN("Parity length has unexpected value. Expected %li, but got %li\n", parityLen, fecHdr->parityLen);
+        return etcpEBADPKT;
+    }
+
+    //Find the connection for this packet. Parity never makes a new connection, the data packets do that.
+    const htKey_t dstKey = {.keyHi = flowId->dstAddr, .keyLo = flowId->dstPort };
+    etcpLAMap_t* srcsMap = NULL;
+    htError_t htErr = htGet(state->dstMap,&dstKey,(void**)&srcsMap);
+    if_unlikely(htErr != htENOEROR){
+        return etcpEREJCONN;
+    }
+    etcpConn_t* recvConn = NULL;
+    const htKey_t srcKey = { .keyHi = flowId->srcAddr, .keyLo = flowId->srcPort };
+    htErr = htGet(srcsMap->table,&srcKey,(void**)&recvConn);
+    if_unlikely(htErr != htENOEROR){
+        return etcpEREJCONN;
+    }
+
+    if_unlikely(fecHdr->urgent){
+        recvConn = recvConn->urgent;
+    }
+
+    if_unlikely(recvConn->fecLog2 == 0 || recvConn->fecLog2 != fecHdr->groupSizeLog2){
+        return etcpENOERR; //We haven't collected anything this parity can be used with
+    }
+
+    const i64 groupId   = fecHdr->seqBase >> recvConn->fecLog2;
+    pgGroup_t* const pg = recvConn->fecRx[groupId & (ETCP_FEC_RX_GROUPS - 1)];
+    if_eqlikely(pg->groupId != groupId){
+        return etcpENOERR; //Too old, or we've not seen anything from this group
+    }
+
+    //Rebuild straight into a data packet. Copy the encapsulation and ETCP headers from the parity packet, the parity then
+    //turns into the data header summary followed by the payload. The summary is unpacked into the real data header, which
+    //overlaps it, so the payload ends up in the right place without another copy.
+    const i64 hdrsOffset = (i8*)pbuff->etcpHdr - (i8*)pbuff->buffer;
+    const i64 rebuiltLen = hdrsOffset + pbuff->etcpHdrSize + sizeof(etcpMsgDatHdr_t) + parityLen;
+    if_unlikely((i64)sizeof(pBuff_t) + rebuiltLen > recvConn->fecFrameSize){
+        WARN("Parity packet is too big to rebuild from (%liB)\n", parityLen);
+        return etcpETOOBIG;
+    }
+
+    pBuff_t* const rebuilt = (pBuff_t*)recvConn->fecFrame;
+    memset(rebuilt,0,sizeof(pBuff_t));
+    rebuilt->buffer       = rebuilt + 1;
+    rebuilt->encapHdr     = rebuilt->buffer;
+    rebuilt->encapHdrSize = pbuff->encapHdrSize;
+    rebuilt->etcpHdr      = (etcpMsgHead_t*)((i8*)rebuilt->buffer + hdrsOffset);
+    rebuilt->etcpHdrSize  = pbuff->etcpHdrSize;
+    memcpy(rebuilt->buffer,pbuff->buffer,hdrsOffset + pbuff->etcpHdrSize);
+    rebuilt->etcpHdr->fulltype = ETCP_V1_FULLHEAD(ETCP_DAT);
+
+    etcpMsgDatHdr_t* const datHdr = (etcpMsgDatHdr_t*)(rebuilt->etcpHdr + 1);
+    i8* const block = (i8*)(datHdr + 1) - sizeof(etcpFecDatSummary_t);
+    i64 idx = -1;
+    const pgError_t err = pgRebuild(pg,1LL << recvConn->fecLog2,fecHdr + 1,parityLen,block,&idx);
+    if_eqlikely(err == pgENOREBUILD){
+        return etcpENOERR; //Nothing missing, or too much missing
+    }
+    else if_unlikely(err != pgENOERR){
+        WARN("Could not rebuild from parity: %s\n", pgError2Str(err));
+        return etcpEBADPKT;
+    }
+
+    etcpFecDatSummary_t summary;
+    memcpy(&summary,block,sizeof(summary));
+    if_unlikely(summary.datLen > parityLen - sizeof(summary)){
+        WARN("Rebuilt packet is corrupt, length %li is longer than the parity\n", summary.datLen);
+        return etcpEBADPKT;
+    }
+
+    memset(datHdr,0,sizeof(etcpMsgDatHdr_t));
+    datHdr->seqNum    = fecHdr->seqBase + idx;
+    datHdr->datLen    = summary.datLen;
+    datHdr->noAck     = summary.noAck;
+    datHdr->noRet     = summary.noRet;
+    datHdr->skipDat   = summary.skipDat;
+    datHdr->urgent    = fecHdr->urgent;
+    datHdr->fecLog2   = fecHdr->groupSizeLog2;
+    datHdr->streamId  = summary.streamId;
+    datHdr->streamSeq = summary.streamSeq;
+
+    rebuilt->msgSize  = rebuilt->encapHdrSize + rebuilt->etcpHdrSize + sizeof(etcpMsgDatHdr_t) + summary.datLen;
+    rebuilt->buffSize = rebuiltLen;
+
+    DBG("Rebuilt seq %li from parity for group at %li\n", datHdr->seqNum, fecHdr->seqBase);
+    return etcpOnRxDat(state,rebuilt,flowId);
+}
+
+//A part of the round trip, from one clock. -1 if either end is missing, or it doesn't fit in the round trip at all, which
+//means that the two clocks are not comparable (eg hardware vs software, see packets.h)
+static inline i64 etcpLatPart(const uint64_t fromNs, const uint64_t toNs, const i64 rttNs)
+{
+    const i64 part = (i64)(toNs - fromNs);
+    return fromNs == 0 || toNs == 0 || part < 0 || part > rttNs ? -1 : part;
+}
+
+
+//Break down the round trip of a data packet and the ack that came back for it, see etcpLatency_t. datTime is our copy of the
+//data packet's times, datEcho is the same packet's times as the remote end saw it (echoed back in the ack).
+static inline void etcpLatencyRecord(etcpConn_t* const conn, const etcpTime_t* const datTime, const etcpTime_t* const datEcho, const etcpTime_t* const ackTime)
+{
+    etcpLatency_t* const rec = &conn->lat.recs[conn->lat.count & ((1 << ETCP_LAT_RING_LOG2) - 1)];
+    rec->timeNs      = ackTime->swRxTimeNs;
+    rec->rttNs       = ackTime->swRxTimeNs - datTime->swTxTimeNs;
+    rec->localTxNs   = etcpLatPart(datTime->swTxTimeNs, datTime->hwTxTimeNs, rec->rttNs);
+    rec->localRxNs   = etcpLatPart(ackTime->hwRxTimeNs, ackTime->swRxTimeNs, rec->rttNs);
+    rec->remoteRxNs  = etcpLatPart(datEcho->hwRxTimeNs, datEcho->swRxTimeNs, rec->rttNs);
+    rec->remoteAckNs = etcpLatPart(datEcho->swRxTimeNs, ackTime->swTxTimeNs, rec->rttNs);
+    rec->networkNs   = rec->rttNs - MAX(rec->localTxNs,0) - MAX(rec->localRxNs,0) - MAX(rec->remoteRxNs,0) - MAX(rec->remoteAckNs,0);
+
+    //The same four software times are an NTP style exchange, which keeps track of the remote clock for the one way delays
+    rec->fwdNs = -1;
+    rec->revNs = -1;
+    if_likely(datEcho->swRxTimeNs != 0 && ackTime->swTxTimeNs != 0){
+        coSample(&conn->peerClock,datTime->swTxTimeNs,datEcho->swRxTimeNs,ackTime->swTxTimeNs,ackTime->swRxTimeNs);
+    }
+    if_likely(conn->peerClock.samples > 0){
+        rec->fwdNs = MAX((i64)(datEcho->swRxTimeNs - datTime->swTxTimeNs) - coOffsetAt(&conn->peerClock,datTime->swTxTimeNs), 0);
+        rec->revNs = MAX((i64)(ackTime->swRxTimeNs - ackTime->swTxTimeNs) + coOffsetAt(&conn->peerClock,ackTime->swRxTimeNs), 0);
+    }
+    conn->lat.count++;
+}
+
+
+//Record an event for the event driven TX TC, see etcpTxEvtTc_f. A run of queued or ack'd packets that carries on from the
+//latest event of the same type is folded into it, and RTT samples are folded into the latest one, see etcpTcEvts_t.
+static inline void etcpTcEvt(etcpConn_t* const conn, const etcpTcEvtType_t type, const i64 seq, const i64 count, const i64 valNs)
+{
+    if_likely(!etcpTxTcIsEvt(conn->state)){
+        return;
     }
 
-    const pBuff_t* pbuff = slot->buff;
+    etcpTcEvts_t* const tcEvts = &conn->tcEvts;
+    const bool folds = type == etcpTC_QUEUED || type == etcpTC_ACKED || type == etcpTC_RTT;
+    if_likely(folds && tcEvts->__latest[type] > 0){
+        etcpTcEvt_t* const latest = &tcEvts->evts[tcEvts->__latest[type] - 1];
+        if_likely(type == etcpTC_RTT || latest->seq + latest->count == seq){
+            latest->seq    = type == etcpTC_RTT ? seq : latest->seq;
+            latest->count += count;
+            latest->valNs  = valNs;
+            return;
+        }
+    }
+
+    if_unlikely(tcEvts->count >= ETCP_TC_EVTS_MAX - (type != etcpTC_TIMER)){
+        tcEvts->dropped++;
+        return;
+    }
+
+    etcpTcEvt_t* const evt = &tcEvts->evts[tcEvts->count++];
+    evt->type  = type;
+    evt->seq   = seq;
+    evt->count = count;
+    evt->valNs = valNs;
+    tcEvts->__latest[type] = folds ? tcEvts->count : 0;
+}
+
+
+//Take the timing stats from one ack'd packet
+static inline void etcpAckStats(etcpConn_t* const conn, const pBuff_t* const pbuff, const etcpTime_t* const ackTime, const etcpTime_t* const datFirstTime, const etcpTime_t* const datLastTime, const i64 datLastSeq)
+{
     const etcpMsgHead_t* const head = pbuff->etcpHdr;
     const etcpMsgDatHdr_t* const datHdr = pbuff->etcpDatHdr;
-    if_unlikely(seq != datHdr->seqNum){
-        WARN("Got an ACK for a packet that's gone.\n");
+
+    const i64 totalRttTime = ackTime->swRxTimeNs - head->ts.swTxTimeNs; //Total round trip for the sack vs dat
+    (void)datFirstTime; //Not needed right now
+    DBG("Total RTT:           %lins (%lius, %lims, %lis)\n", totalRttTime, totalRttTime / 1000, totalRttTime / 1000/1000, totalRttTime / 1000/1000/1000);
+
+    conn->txOrderAcked = pbuff->txOrder > conn->txOrderAcked ? pbuff->txOrder : conn->txOrderAcked;
+
+    //Feed the path this packet went out on. Only use packets sent once, otherwise we can't tell which send is being ack'd.
+    if_unlikely(pbuff->txPath >= 0 && pbuff->txPath < conn->pathCount && datHdr->txAttempts == 1){
+        etcpPath_t* const path = &conn->paths[pbuff->txPath];
+        rttSample(&path->rtt,totalRttTime,ackTime->swRxTimeNs);
+    }
+
+    //Same again for the connection as a whole
+    if_likely(datHdr->txAttempts == 1){
+        rttSample(&conn->rtt,totalRttTime,ackTime->swRxTimeNs);
+        etcpTcEvt(conn,etcpTC_RTT,datHdr->seqNum,1,totalRttTime);
+
+        //The ack echoes back the remote times for the newest packet it acks. Match it by seq, every packet sent in the same
+        //pass has the same send time.
+        if_unlikely((i64)datHdr->seqNum == datLastSeq){
+            etcpLatencyRecord(conn,&head->ts,datLastTime,ackTime);
+        }
+    }
+}
+
+
+//Release a run of ack'd slots from the TX queue in one go, so that the read pointer moves (at most) once per run
+static inline etcpError_t etcpReleaseAcked(cq_t* const cq, const i64 seqFrom, const i64 count)
+{
+    if_unlikely(count <= 0){
         return etcpENOERR;
     }
-    //Successful ack! -- Do timing stats here
-    DBG("Successful ack for seq %li\n", seq);
-
-    //TODO XXX can do stats here.
-    const i64 totalRttTime     = ackTime->swRxTimeNs - head->ts.swTxTimeNs; //Total round trip for the sack vs dat
-//    const i64 remoteProcessing = ackTime->swTxTimeNs - datFirstTime->swRxTimeNs; //Time between the first data packet RX and the ack TX
-//    //Not supported without NIC help, assume this is constant on both sides
-//    //const i64 remoteHwTime     = ackTime->hwTxTimeNs - ackTime->hwRxTimeNs; //Time in hardware on the remote side
-//    const i64 localHwTxTime    = head->ts.hwTxTimeNs - head->ts.swTxTimeNs; //Time in TX hardware on the local side
-//    const i64 localHwRxTime    = ackTime->swRxTimeNs - ackTime->hwRxTimeNs; //Time in RX hardware on the local side
-//    const i64 localHwTime      = localHwTxTime + localHwRxTime;
-//    const i64 remoteHwTime     = localHwTime;
-//    const i64 networkTime      = totalRttTime - remoteHwTime - remoteProcessing - localHwTime;
-    (void)datLastTime;//Not needed right now
-    (void)datFirstTime;
-//    DBG("TIMING STATS:\n");
-//    DBG("-------------------------------------\n");
-    DBG("Total RTT:           %lins (%lius, %lims, %lis)\n", totalRttTime, totalRttTime / 1000, totalRttTime / 1000/1000, totalRttTime / 1000/1000/1000);
-//    DBG("Remote Processing:   %lins (%lius, %lims, %lis)\n", remoteProcessing, remoteProcessing/ 1000, remoteProcessing / 1000/1000, remoteProcessing / 1000/1000/1000);
-//    DBG("Local HW TX:         %lins (%lius, %lims, %lis)\n", localHwTxTime, localHwTxTime / 1000, localHwTxTime / 1000/1000, localHwTxTime / 1000/1000/1000 );
-//    DBG("Local HW RX:         %lins (%lius, %lims, %lis)\n", localHwRxTime, localHwRxTime / 1000, localHwRxTime / 1000/1000, localHwRxTime / 1000/1000/1000 );
-//    DBG("Local HW:            %lins (%lius, %lims, %lis)\n", localHwTime, localHwTime/1000, localHwTime / 1000/1000, localHwTime / 1000/1000/1000);
-//    DBG("Remote HW (guess)    %lins (%lius, %lims, %lis)\n", remoteHwTime, remoteHwTime/1000, remoteHwTime/ 1000/1000, remoteHwTime / 1000/1000/1000);
-//    DBG("Network time:        %lins (%lius, %lims, %lis)\n", networkTime, networkTime/1000, networkTime/1000/1000, networkTime / 1000/1000/1000);
-//    DBG("-------------------------------------\n");
-
-    //Packet is now ack'd, we can release this slot and use it for another TX
-    const cqError_t cqErr = cqReleaseSlot(cq,seq);
-    if_unlikely(cqErr != cqENOERR){
+
+    //A sack beyond a hole releases slots out of order, which leaves the read pointer where it is until the hole is filled.
+    const cqError_t cqErr = cqReleaseRange(cq,seqFrom,count);
+    if_unlikely(cqErr != cqENOERR && cqErr != cqENOCHANGE){
         ERR("Unexpected cq error: %s\n", cqError2Str(cqErr));
         return etcpECQERR;
     }
@@ -206,13 +526,106 @@ static inline  etcpError_t etcpProcessAck(cq_t* const cq, const uint64_t seq, co
 }
 
 
+//Apply one sack field, acking seqFrom ... seqFrom + count - 1
+static inline  etcpError_t etcpProcessAckRange(etcpConn_t* const conn, const i64 seqFrom, const i64 count, const etcpTime_t* const ackTime, const etcpTime_t* const datFirstTime, const etcpTime_t* const datLastTime, const i64 datLastSeq)
+{
+    cq_t* const cq = conn->txQ;
+    if_unlikely(seqFrom < 0 || count <= 0){
+        return etcpENOERR;
+    }
+
+    //Only what is still in the window can be ack'd, anything below it has already been accepted.
+    const i64 seqTo = seqFrom + count;
+    const i64 seqLo = MAX(seqFrom, cq->rdMin);
+    if(seqLo >= seqTo){
+        WARN("Stale ack, this ack has already been accepted\n");
+        return etcpENOERR;
+    }
+    if_unlikely(seqTo > cq->wrMax){
+        WARN("Ack for seq %li-%li is beyond the end of the window at %li\n", seqFrom, seqTo - 1, cq->wrMax);
+        return etcpERANGE;
+    }
+
+    //Stats come from every packet, but the slots are only released once for each run of packets that are still there
+    bool acked = false;
+    i64 runStart = seqLo;
+    for(i64 seq = seqLo; seq < seqTo; seq++){
+        cqSlot_t* slot = NULL;
+        const cqError_t err = cqGetRd(cq,&slot,seq);
+        const pBuff_t* const pbuff = err == cqENOERR ? slot->buff : NULL;
+        if_unlikely(pbuff == NULL || (i64)pbuff->etcpDatHdr->seqNum != seq){
+            //Already ack'd by an earlier sack, or not the packet this ack is for. Either way leave it alone.
+            DBG("Skipping ack for seq %li, the packet is gone\n", seq);
+            const etcpError_t relErr = etcpReleaseAcked(cq,runStart,seq - runStart);
+            if_unlikely(relErr != etcpENOERR){
+                return relErr;
+            }
+            runStart = seq + 1;
+            continue;
+        }
+
+        //Successful ack! -- Do timing stats here
+        DBG("Successful ack for seq %li\n", seq);
+        etcpAckStats(conn,pbuff,ackTime,datFirstTime,datLastTime,datLastSeq);
+        acked = true;
+
+        conn->txOutstanding -= pbuff->etcpDatHdr->txAttempts > 0;
+        conn->txLost        -= pbuff->lost;
+        conn->tcAcked++;
+        conn->tcTimeouts = 0;
+        etcpTcEvt(conn,etcpTC_ACKED,seq,1,ackTime->swRxTimeNs);
+    }
+
+    const etcpError_t relErr = etcpReleaseAcked(cq,runStart,seqTo - runStart);
+    if_unlikely(relErr != etcpENOERR){
+        return relErr;
+    }
+
+    //Something got through, so the tail (if there is one) isn't stuck yet. Start the probe timer again.
+    if_likely(acked){
+        conn->tlpArmNs = ackTime->swRxTimeNs;
+        conn->tlpSent  = false;
+    }
+
+    return etcpENOERR;
+}
+
+
+
+//Anything still waiting for an ack that went out ETCP_REORDER_THRESH or more transmissions before the latest one that has
+//been ack'd is presumed lost. It's marked so that the TC can resend it now, rather than waiting for a timeout. Counting in
+//transmissions rather than sequence numbers means a resent packet is only judged against packets sent after the resend.
+static inline void etcpMarkLost(etcpConn_t* const conn)
+{
+    cq_t* const cq = conn->txQ;
+    for(i64 i = cq->rdMin; i < cq->rdMax; i++){
+        cqSlot_t* slot = NULL;
+        const cqError_t err = cqGetRd(cq,&slot,i);
+        if_eqlikely(err != cqENOERR){
+            continue; //Already ack'd
+        }
+
+        pBuff_t* const pbuff = slot->buff;
+        if_eqlikely(pbuff->lost || pbuff->txOrder < 0){
+            continue; //Already marked, or not sent yet
+        }
+
+        if_unlikely(pbuff->txOrder + ETCP_REORDER_THRESH <= conn->txOrderAcked){
+            DBG("Seq %li presumed lost, sent at %li, %li has been ack'd\n", i, pbuff->txOrder, conn->txOrderAcked);
+            pbuff->lost = true;
+            conn->txLost++;
+            etcpTcEvt(conn,etcpTC_LOST,i,1,conn->state->nowNs);
+        }
+    }
+}
+
 
 static inline  etcpError_t etcpOnRxAck(etcpState_t* const state, pBuff_t* const pbuff, const etcpFlowId_t* const flowId)
 {
     //DBG("Working on new ack message\n");
 
     const i64 minSizeSackHdr = sizeof(etcpMsgSackHdr_t);
-    const i64 msgSpace = pbuff->msgSize - pbuff->encapHdrSize - pbuff->etcpDatHdrSize;
+    const i64 msgSpace = pbuff->msgSize - pbuff->encapHdrSize - pbuff->etcpHdrSize;
     if_unlikely(msgSpace < minSizeSackHdr){
         WARN("Not enough bytes to parse sack header, required %li but got %li\n", minSizeSackHdr, msgSpace);
         return etcpEBADPKT; //Bad packet, not enough data in it
@@ -257,29 +670,56 @@ static inline  etcpError_t etcpOnRxAck(etcpState_t* const state, pBuff_t* const
     }
 
     //By now we have located the connection structure for this ack packet
+    if_unlikely(sackHdr->urgent){
+        conn = conn->urgent; //These acks are for the urgent lane sequence space
+    }
+
     //Try to put the sack into the AckRxQ so that the Transmission Control function can use it as an input
     i64 slotIdx = -1;
-    i64 len    = pbuff->buffSize + sizeof(pBuff_t);
-    i64 lenTmp = sackLen;
-    cqPushNext(conn->rxQ,sackHdr, &lenTmp,&slotIdx); //No error checking it's ok if this fails.
-    if(len < sackLen){
+    const i64 len = minSizeSackHdr + sackLen; //The sack header and all of its fields
+    i64 lenTmp    = len;
+    const cqError_t cqErr = cqPushNext(conn->rxQ,sackHdr, &lenTmp,&slotIdx); //No error checking it's ok if this fails.
+    if(lenTmp < len){
         WARN("Truncated SACK packet into ackRxQ\n");
     }
-    cqCommitSlot(conn->rxQ,slotIdx,len);
+    if_likely(cqErr == cqENOERR || cqErr == cqETRUNC){
+        cqCommitSlot(conn->rxQ,slotIdx,lenTmp);
+    }
 
 
     //Process the acks and apply to TX packets waiting.
+    const i64 txOrderAckedBefore = conn->txOrderAcked;
     const uint64_t sackBaseSeq = sackHdr->sackBaseSeq;
+
+    //The receiver's window only ever moves forwards, an older ack that turns up late doesn't shrink it
+    if_likely(sackHdr->cumAck){
+        conn->txEdge = MAX(conn->txEdge, (i64)(sackHdr->sackBaseSeq + sackHdr->rxWindowSegs));
+    }
+
+    //Everything below a cumulative ack has been received, so it can all be released in one go. In the common case (nothing
+    //lost) that's the whole ack, and the fields are only there for what arrived beyond a hole.
+    if_likely(sackHdr->cumAck && sackHdr->sackBaseSeq > conn->txQ->rdMin){
+        const i64 cumFrom = conn->txQ->rdMin;
+        DBG("Working on cumulative ACK for %li-%li\n", cumFrom, sackHdr->sackBaseSeq - 1);
+        const etcpError_t err = etcpProcessAckRange(conn,cumFrom,sackHdr->sackBaseSeq - cumFrom,&pbuff->etcpHdr->ts, &sackHdr->timeFirst, &sackHdr->timeLast, sackHdr->timeLastSeq);
+        if_unlikely(err != etcpENOERR){
+            return err;
+        }
+    }
     for(i64 sackIdx = 0; sackIdx < sackHdr->sackCount; sackIdx++){
         const uint64_t ackOffset = sackFields[sackIdx].offset;
         const uint64_t ackCount  = sackFields[sackIdx].count;
         DBG("Working on %li ACKs starting at %li \n", ackCount, sackBaseSeq + ackOffset);
-        for(uint16_t ackIdx = 0; ackIdx < ackCount; ackIdx++){
-            const uint64_t ackSeq = sackBaseSeq + ackOffset + ackIdx;
-            etcpProcessAck(conn->txQ,ackSeq,&pbuff->etcpHdr->ts, &sackHdr->timeFirst, &sackHdr->timeLast);
+        const etcpError_t err = etcpProcessAckRange(conn,sackBaseSeq + ackOffset,ackCount,&pbuff->etcpHdr->ts, &sackHdr->timeFirst, &sackHdr->timeLast, sackHdr->timeLastSeq);
+        if_unlikely(err != etcpENOERR){
+            return err;
         }
     }
 
+    if_eqlikely(conn->txOrderAcked != txOrderAckedBefore){
+        etcpMarkLost(conn);
+    }
+
     return etcpENOERR;
 }
 
@@ -296,11 +736,9 @@ static inline  etcpError_t etcpOnRxPacket(etcpState_t* const state, pBuff_t* con
     }
     etcpMsgHead_t* const head = pbuff->etcpHdr;
 
-    //Get a timestamp as soon as we know we have a place to put it.
-    struct timespec ts = {0};
-    clock_gettime(CLOCK_REALTIME,&ts);
+    //The time the RX poll started, which all of the packets in this burst share
     head->ts.hwRxTimeNs = hwRxTimeNs;
-    head->ts.swRxTimeNs  = ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+    head->ts.swRxTimeNs = state->nowNs;
     head->hwRxTs = 1;
     head->swRxTs = 1;
 
@@ -321,6 +759,9 @@ static inline  etcpError_t etcpOnRxPacket(etcpState_t* const state, pBuff_t* con
         case ETCP_V1_FULLHEAD(ETCP_ACK):
             return etcpOnRxAck(state, pbuff, &flowId);
 
+        case ETCP_V1_FULLHEAD(ETCP_FEC):
+            return etcpOnRxFec(state, pbuff, &flowId);
+
         default:
             WARN("Bad header, unrecognised type msg_magic=%li (should be %li), version=%i (should be=%i), type=%li\n",
                     head->magic, ETCP_MAGIC, head->ver, ETCP_V1, head->type);
@@ -438,6 +879,11 @@ static inline etcpError_t pushSackEthPacket(etcpConn_t* const conn, const i8* co
     pBuff_t * pBuff = slot->buff;
     pBuff->buffer = (i8*)slot->buff + sizeof(pBuff_t);
     pBuff->buffSize = slot->len - sizeof(pBuff_t);
+    pBuff->deadlineNs = ETCP_NO_DEADLINE; //Acks never expire
+    pBuff->txPath     = -1;
+    pBuff->txOrder    = -1;
+    pBuff->lost       = false;
+    pBuff->probe      = false;
 
     i8* buff = pBuff->buffer;
     i64 buffLen = pBuff->buffSize;
@@ -479,6 +925,8 @@ static inline etcpError_t pushSackEthPacket(etcpConn_t* const conn, const i8* co
     pBuff->msgSize         += pBuff->etcpPayloadSize;
 
     memcpy(buff,sackHdrAndData,sackHdrAndDatSize);
+    pBuff->etcpSackHdr->urgent    = conn->isUrgent;
+    pBuff->etcpSackHdr->sackCount = sackCount;
 
     cqErr = cqCommitSlot(conn->txQ,seqNum,ethEtcpSackPktSize);
     if_unlikely(cqErr != cqENOERR){
@@ -602,7 +1050,8 @@ etcpError_t generateStaleAcks(etcpConn_t* const conn, const i64 maxAckPackets, c
         }
         unsentAcks++;
         sackFields[fieldIdx].count++;
-        sackHdr->timeLast = head->ts;
+        sackHdr->timeLast    = head->ts;
+        sackHdr->timeLastSeq = datHdr->seqNum;
         datHdr->ackSent = 1;
         expectSeqNum++;
         DBG("Made stale sack for seq=%li in field %li, offset=%i, count=%i, off + count=%i\n", i,fieldIdx, sackFields[fieldIdx].offset, sackFields[fieldIdx].count, sackFields[fieldIdx].offset + sackFields[fieldIdx].count );
@@ -627,6 +1076,24 @@ etcpError_t generateStaleAcks(etcpConn_t* const conn, const i64 maxAckPackets, c
 
 
 
+//When the reader has freed up a good part of the window since the last ack, the sender needs to hear about it even if there
+//is nothing new to ack. Otherwise a sender that has filled the window waits forever.
+static inline bool etcpRxWindowUpdateDue(const etcpConn_t* const conn)
+{
+    return conn->rxQ->wrMax - conn->rxEdgeSent >= MAX(conn->rxQ->__slotCount / 2, 1);
+}
+
+
+//The most sack fields that will go into one ack packet on this connection, bounded by the MTU and by the size of the slots in
+//the ack TX queue.
+static inline i64 etcpSackFieldsMax(const etcpConn_t* const conn)
+{
+    const i64 slotSpace  = conn->txQ->slotDataSize - (i64)sizeof(pBuff_t) - ETCP_ETH_OVERHEAD - (i64)ETCP_SACKHDR_OVERHEAD;
+    const i64 slotFields = slotSpace / (i64)sizeof(etcpSackField_t);
+    return MAX(MIN(slotFields, ETCP_MAX_SACKS_MTU), 1);
+}
+
+
 //Traverse the receive queues and generate ack's
 etcpError_t generateAcks(etcpConn_t* const conn, const i64 maxAckPackets, const i64 maxSlots)
 {
@@ -634,31 +1101,81 @@ etcpError_t generateAcks(etcpConn_t* const conn, const i64 maxAckPackets, const
         return etcpENOERR; //Don't bother trying if you don't want me to!
     }
 
-
-    if_unlikely(conn->rxQ->readable == 0){
-        return etcpENOERR; //There's nothing to do here
+    //Go all the way to the end of the window, not just to rdMax (the first hole), so that what arrived beyond a loss is
+    //sack'd as well. That's what lets the sender work out that the hole is a loss.
+    const i64 rdMin = conn->rxQ->rdMin;
+    const i64 rxEnd = maxSlots < conn->rxQ->wrMax - rdMin ? rdMin + maxSlots : conn->rxQ->wrMax; //maxSlots may be INT64_MAX
+    i64 runStart = -1;
+    i64 runLen   = 0;
+    const bool haveRuns     = bmNextRun(conn->rxRcvd,conn->rxAcked,rdMin,rxEnd,&runStart,&runLen);
+    const bool windowUpdate = etcpRxWindowUpdateDue(conn);
+    if_eqlikely(!haveRuns && !windowUpdate){
+        return etcpENOERR; //Everything that has arrived has been ack'd already
     }
 
+    //Everything up to the first hole is covered by the cumulative ack. Only the runs beyond it need sack fields. Every packet
+    //also says how much room is left in the window beyond the cumulative ack.
+    const i64 cumAckSeq    = bmFirstClear(conn->rxRcvd,rdMin,rxEnd);
+    const i64 rxWindowSegs = conn->rxQ->wrMax - cumAckSeq;
+
     i64 fieldIdx          = 0;
-    bool fieldInProgress  = false;
-    i64 unsentAcks        = 0;
-    const i64 tmpBuffSize = sizeof(etcpMsgSackHdr_t) + sizeof(etcpSackField_t) * ETCP_MAX_SACKS;
+    i64 pktRuns           = 0;
+    i64 ackedPkts         = 0;
+    const i64 maxFields   = etcpSackFieldsMax(conn);
+    const i64 tmpBuffSize = sizeof(etcpMsgSackHdr_t) + sizeof(etcpSackField_t) * maxFields;
     assert(sizeof(tmpBuffSize) <=  256);
     i8 tmpBuff[tmpBuffSize];
     memset(tmpBuff,0,tmpBuffSize);
 
     etcpMsgSackHdr_t* const sackHdr  = (etcpMsgSackHdr_t* const)(tmpBuff + 0 );
     etcpSackField_t* const sackFields = ( etcpSackField_t* const)(tmpBuff + sizeof(etcpMsgSackHdr_t));
+    sackHdr->sackBaseSeq  = cumAckSeq;
+    sackHdr->cumAck       = 1;
+    sackHdr->rxWindowSegs = rxWindowSegs;
 
-    //Iterate through the rx packets to build up sack ranges
+    //Each run of packets that have arrived but not yet been ack'd is either under the cumulative ack or a sack field. The
+    //bitmaps find the runs a word (64 slots) at a time, so only the packets at the ends of the runs (for the timestamps) are
+    //looked at.
     i64 completeAckPackets = 0;
-    for(i64 i = conn->rxQ->rdMin; i < conn->rxQ->rdMax && i < conn->rxQ->rdMin + maxSlots; i++){
+    for(bool haveRun = haveRuns; haveRun; haveRun = bmNextRun(conn->rxRcvd,conn->rxAcked,runStart + runLen,rxEnd,&runStart,&runLen)){
+
+        cqSlot_t* firstSlot = NULL;
+        cqSlot_t* lastSlot  = NULL;
+        cqError_t err = cqGetRd(conn->rxQ,&firstSlot,runStart);
+        if_likely(err == cqENOERR){
+            err = cqGetRd(conn->rxQ,&lastSlot,runStart + runLen - 1);
+        }
+        if_unlikely(err != cqENOERR){
+            ERR("Error getting slot: %s\n", cqError2Str(err));
+            return etcpECQERR;
+        }
+
+        //Every packet has the same base, so the offsets are never negative
+        if_unlikely(pktRuns == 0){ //If we're starting a new sack packet, we need some extra fields
+            sackHdr->timeFirst    = ((const pBuff_t*)firstSlot->buff)->etcpHdr->ts;
+            DBG("Staring new sack packet with cumulative ack = %li\n", sackHdr->sackBaseSeq);
+        }
+        sackHdr->timeLast    = ((const pBuff_t*)lastSlot->buff)->etcpHdr->ts;
+        sackHdr->timeLastSeq = runStart + runLen - 1;
+        pktRuns++;
+
+        bmSetRange(conn->rxAcked,runStart,runLen); //Mark the packets as ack-sent so they will get delivered to users
+        ackedPkts += runLen;
+
+        if_likely(runStart < cumAckSeq){
+            DBG("Made cumulative ack for seq=%li-%li\n", runStart, runStart + runLen - 1);
+            continue;
+        }
+
+        sackFields[fieldIdx].offset = runStart - cumAckSeq;
+        sackFields[fieldIdx].count  = runLen;
+        DBG("Made sack for seq=%li-%li in field %li, offset=%i, count=%i\n", runStart, runStart + runLen - 1, fieldIdx, sackFields[fieldIdx].offset, sackFields[fieldIdx].count);
+        fieldIdx++;
 
         //We collected enough sack fields to make a whole packet and send it
-        if_unlikely(fieldIdx >= ETCP_MAX_SACKS){
-            //sackHdr->rxWindowSegs = 0;
+        if_unlikely(fieldIdx >= maxFields){
             DBG("Sending sack packet\n");
-            etcpError_t err = pushSackEthPacket(conn,tmpBuff,ETCP_MAX_SACKS);
+            etcpError_t err = pushSackEthPacket(conn,tmpBuff,maxFields);
             if_unlikely(err == etcpETRYAGAIN){
                 WARN("Ran out of slots for sending acks, come back again\n");
                 return err;
@@ -667,112 +1184,328 @@ etcpError_t generateAcks(etcpConn_t* const conn, const i64 maxAckPackets, const
                 ERR("Unexpected error making ack packet\n");
                 return err;
             }
-
-            //Account for the now sent messages by updating the seqAck value, only do so up to the edge of the first field, this
-            //is the limit that will be receivable until new packets come.
-            conn->seqAck = conn->seqAck + sackFields[0].offset + sackFields[0].count;
+            completeAckPackets++;
 
             //Reset the sackStructure to make a new one
             memset(tmpBuff,0,tmpBuffSize);
-            fieldIdx        = 0;
-            fieldInProgress = false;
-            unsentAcks      = 0;
+            sackHdr->sackBaseSeq  = cumAckSeq;
+            sackHdr->cumAck       = 1;
+            sackHdr->rxWindowSegs = rxWindowSegs;
+            fieldIdx = 0;
+            pktRuns  = 0;
 
             if(completeAckPackets >= maxAckPackets){
-                return etcpENOERR;
+                break;
             }
         }
+    }
 
-
-        //DBG("Now looking at seq %i\n", i);
-        cqSlot_t* slot = NULL;
-        const cqError_t err = cqGetRd(conn->rxQ,&slot,i);
-
-        //This slot is empty, so stop making the field and start a new one
-        if_eqlikely(err == cqEWRONGSLOT){
-            //The slot is empty --
-            if_likely(fieldInProgress){
-                fieldIdx++;
-                fieldInProgress = false;
-            }
-            continue;
+    //Push the last sack out. This may have no fields at all, if everything is under the cumulative ack, or if it's only here to
+    //tell the sender that the window has opened up
+    if(pktRuns > 0 || (completeAckPackets == 0 && windowUpdate)){
+        DBG("Sending sack packet\n");
+        etcpError_t err = pushSackEthPacket(conn,tmpBuff,fieldIdx);
+        if_unlikely(err == etcpETRYAGAIN){
+            WARN("Ran out of slots for sending acks, come back again\n");
+            return err;
         }
-        else if_unlikely(err != cqENOERR){
-            ERR("Error getting slot: %s\n", cqError2Str(err));
-            return etcpECQERR;
+        else if_unlikely(err != etcpENOERR){
+            ERR("Unexpected error making ack packet\n");
+            return err;
         }
+    }
 
-        //At this point we have a valid packet
-        const pBuff_t* const pbuff          = slot->buff;
-        const etcpMsgHead_t* const head     = pbuff->etcpHdr;
-        etcpMsgDatHdr_t* const datHdr       = pbuff->etcpDatHdr;
+    conn->seqAck     = cumAckSeq;
+    conn->rxEdgeSent = conn->rxQ->wrMax;
+    conn->ackWaiting = MAX(conn->ackWaiting - ackedPkts, 0);
+    conn->ackNowReq  = conn->ackNowReq && conn->ackWaiting > 0;
+    return etcpENOERR;
 
-        if_eqlikely(datHdr->ackSent){
-            //This packet has been processed and ack'd, we're just waiting for it to be cleared from the window by a user RX
-            continue;
-        }
+}
 
-        if_eqlikely(datHdr->noAck){
-            //This packet does not want an ack,
-            if_likely(fieldInProgress){
-                fieldIdx++;
-                fieldInProgress = false;
-            }
-            datHdr->ackSent = 1; //Pretend to have sent it so it will get delivered to users
-            continue;
+
+//The built-in ack coalescing, a drop in for the RX TC (see etcpRxTc_f). Either everything waiting is ack'd, or nothing is.
+void doEtcpAckPolicy(const etcpConn_t* const conn, const etcpAckPolicy_t* const policy, i64* const maxAckSlots_o, i64* const maxAckPkts_o,  i64* const maxStaleSlots_o,  i64* const maxStaleAckPkts_o)
+{
+    //Stale packets mean an ack has been lost, the sender is stuck until it gets another
+    *maxStaleSlots_o   = -1;
+    *maxStaleAckPkts_o = -1;
+    *maxAckSlots_o     = 0;
+    *maxAckPkts_o      = 0;
+
+    if_eqlikely(conn->ackWaiting == 0){
+        if_unlikely(etcpRxWindowUpdateDue(conn)){
+            *maxAckSlots_o = -1;
+            *maxAckPkts_o  = -1;
         }
+        return;
+    }
 
-        //Start a new field
-        if_unlikely(!fieldInProgress){
-            if_unlikely(fieldIdx == 0){ //If we're starting a new sack packet, we need some extra fields
-                sackHdr->timeFirst    = head->ts;
-                sackHdr->sackBaseSeq  = conn->seqAck;
-                DBG("Staring new sack packet with sack base = %li\n", sackHdr->sackBaseSeq);
-            }
+    bool ackNow = conn->ackNowReq || conn->ackWaiting >= policy->everyPkts;
 
+    const cq_t* const rxQ = conn->rxQ;
+    ackNow = ackNow || (policy->rxFullPct >= 0 && (conn->rxSeqHi - rxQ->rdMin) * 100 >= policy->rxFullPct * rxQ->__slotCount);
 
-            sackFields[fieldIdx].offset = datHdr->seqNum - conn->seqAck;
-            sackFields[fieldIdx].count = 0;
-            fieldInProgress = true;
-            DBG("Starting new sack field indx=%li, offset = %li\n", fieldIdx, sackFields[fieldIdx].offset);
+    //Only look at the clock if nothing else has decided it
+    ackNow = ackNow || (policy->maxDelayNs >= 0 && conn->state->nowNs - conn->ackWaitingNs >= policy->maxDelayNs);
+
+    if_eqlikely(ackNow){
+        *maxAckSlots_o = -1;
+        *maxAckPkts_o  = -1;
+    }
+}
+
+
+//Run the event driven TX TC (see etcpTxEvtTc_f) for one lane, and mark anything it wants resent. Either connection may be NULL.
+void doEtcpTxEvtTc(etcpState_t* const state, etcpConn_t* const sendConn, const etcpConn_t* const recvConn, bool* const ackFirst_o, i64* const maxAck_o, i64* const maxDat_o)
+{
+    //Either connection will do, they are both given the same TC state, see etcpSetTxTcState()
+    const etcpConn_t* const tcConn = sendConn ? sendConn : recvConn;
+    void* const tcState = tcConn && tcConn->txTcState ? tcConn->txTcState : state->etcpTxTcState;
+
+    etcpTcSummary_t sum = {0};
+    sum.nowNs       = state->nowNs;
+    sum.acksWaiting = recvConn ? recvConn->txQ->readable : 0;
+    sum.urgent      = sendConn ? sendConn->isUrgent : recvConn && recvConn->isUrgent;
+
+    etcpTcAction_t act = {0};
+    act.ackFirst = true;
+    act.maxAck   = -1;
+    act.maxDat   = -1;
+    act.timerNs  = -1;
+
+    if_unlikely(sendConn == NULL){
+        etcpTxEvtTcCall(state,tcState,&sum,NULL,0,&act);
+        *ackFirst_o = act.ackFirst;
+        *maxAck_o   = act.maxAck;
+        *maxDat_o   = 0;
+        return;
+    }
+
+    if_unlikely(sendConn->tcTimerNs >= 0 && state->nowNs >= sendConn->tcTimerNs){
+        sendConn->tcTimerNs = -1;
+        sendConn->tcTimeouts++;
+        etcpTcEvt(sendConn,etcpTC_TIMER,-1,0,state->nowNs);
+    }
 
+    cq_t* const txQ = sendConn->txQ;
+    sum.seqUnacked  = txQ->rdMin;
+    sum.seqSent     = sendConn->txSeqSent;
+    sum.seqQueued   = txQ->rdMax;
+    sum.txEdge      = sendConn->txEdge;
+    sum.outstanding = sendConn->txOutstanding;
+    sum.acked       = sendConn->tcAcked;
+    sum.timeouts    = sendConn->tcTimeouts;
+    sum.lost        = sendConn->txLost;
+    sum.evtsDropped = sendConn->tcEvts.dropped;
+    sum.rtt         = &sendConn->rtt;
+    sum.lat         = &sendConn->lat;
+    act.timerNs     = sendConn->tcTimerNs;
+
+    etcpTxEvtTcCall(state,tcState,&sum,sendConn->tcEvts.evts,sendConn->tcEvts.count,&act);
+    sendConn->tcEvts.count   = 0;
+    sendConn->tcEvts.dropped = 0;
+    sendConn->tcAcked        = 0;
+    memset(sendConn->tcEvts.__latest,0,sizeof(sendConn->tcEvts.__latest));
+    sendConn->tcTimerNs      = act.timerNs;
+
+    //Anything still waiting for an ack in the range goes again. Packets that have never been sent go anyway.
+    const i64 resendFrom = MAX(act.resendFrom, txQ->rdMin);
+    const i64 resendTo   = MIN(act.resendFrom + act.resendCount, sendConn->txSeqSent);
+    for(i64 i = resendFrom; i < resendTo; i++){
+        cqSlot_t* slot = NULL;
+        if_eqlikely(cqGetRd(txQ,&slot,i) != cqENOERR){
+            continue; //Already ack'd
         }
-        unsentAcks++;
-        sackFields[fieldIdx].count++;
-        sackHdr->timeLast = head->ts;
-        datHdr->ackSent = 1; //Mark the packet as ack-sent so it will get delivered to users
-        DBG("Made sack for seq=%li in field %li, offset=%i, count=%i, off + count=%i\n", i,fieldIdx, sackFields[fieldIdx].offset, sackFields[fieldIdx].count, sackFields[fieldIdx].offset + sackFields[fieldIdx].count );
+        pBuff_t* const pbuff = slot->buff;
+        pbuff->txState = pbuff->txState == ETCP_TX_RDY ? ETCP_TX_NOW : pbuff->txState;
     }
 
-    //Push the last sack out
-    if(unsentAcks > 0){
-        sackHdr->sackCount = fieldIdx+1;
-        DBG("Sending sack packet\n");
-        etcpError_t err = pushSackEthPacket(conn,tmpBuff,fieldIdx+1);
-        if_unlikely(err == etcpETRYAGAIN){
-            WARN("Ran out of slots for sending acks, come back again\n");
-            return err;
+    *ackFirst_o = act.ackFirst;
+    *maxAck_o   = act.maxAck;
+    *maxDat_o   = act.maxDat;
+}
+
+
+//Turn a data packet into a "skip" marker in place. The payload is thrown away so that it never goes onto the wire, but the
+//header and sequence number stay. The marker is sent (and retransmitted) like any other data packet so that the receiver
+//learns about the gap and can move past it, rather than waiting forever for data that will never come.
+static inline void etcpDatToSkip(pBuff_t* const pBuff)
+{
+    pBuff->etcpDatHdr->datLen  = 0;
+    pBuff->etcpDatHdr->skipDat = 1;
+    pBuff->etcpPayloadSize     = 0;
+    pBuff->msgSize             = pBuff->encapHdrSize + pBuff->etcpHdrSize + pBuff->etcpDatHdrSize;
+}
+
+
+//Send a frame on a port. If the port gives TX timestamps back later, remember who the frame belongs to so that the
+//timestamp can find its way back to the packet, see etcpOnTxTs().
+//Hardware times on a port in software time, see ethHwClk_f. 0 (no timestamp) stays 0, as does anything before the model is
+//ready, so that it's never compared with a software time.
+static inline uint64_t etcpPortHwToSw(const etcpPort_t* const port, const uint64_t hwTimeNs)
+{
+    if_likely(port->ethHwClk == NULL){
+        return hwTimeNs;
+    }
+    return hwTimeNs == 0 ? 0 : (uint64_t)MAX(cmHwToSw(&port->hwClock, hwTimeNs), 0);
+}
+
+
+static inline int64_t etcpPortTx(etcpPort_t* const port, const void* const data, const i64 len, uint64_t* const hwTxTimeNs_o, etcpConn_t* const conn, const i64 seq, const i64 txOrder)
+{
+    const int64_t result = port->ethHwTx(port->ethHwState, data, len, hwTxTimeNs_o);
+    *hwTxTimeNs_o = etcpPortHwToSw(port, *hwTxTimeNs_o);
+    if_likely(port->ethHwTxTs == NULL || result <= 0){
+        return result;
+    }
+
+    etcpTxPending_t* const pending = &port->txPending[port->txCount & ((1 << ETCP_TX_PENDING_LOG2) - 1)];
+    pending->txId    = port->txCount;
+    pending->conn    = conn;
+    pending->seq     = seq;
+    pending->txOrder = txOrder;
+    port->txCount++;
+
+    return result;
+}
+
+
+//Send the parity for a whole group. Parity is best effort, it is never queued, ack'd or retransmitted. If it can't be sent
+//now, the group is just recovered the normal way.
+static inline void etcpFecSendParity(etcpConn_t* const conn, etcpState_t* const state, const pgGroup_t* const pg)
+{
+    i8* buff    = conn->fecFrame;
+    i64 ethLen  = conn->fecFrameSize;
+    etcpError_t etcpErr = etcpMkEthPkt(buff,&ethLen,conn->flowId.srcAddr, conn->flowId.dstAddr,conn->vlan, conn->priority);
+    if_unlikely(etcpErr != etcpENOERR){
+        WARN("Could not format Ethernet packet\n");
+        return;
+    }
+
+    etcpMsgHead_t* const head = (etcpMsgHead_t* const)(buff + ethLen);
+    memset(head,0,sizeof(etcpMsgHead_t));
+    head->fulltype      = ETCP_V1_FULLHEAD(ETCP_FEC);
+    head->srcPort       = conn->flowId.srcPort;
+    head->dstPort       = conn->flowId.dstPort;
+    head->ts.swTxTimeNs = state->nowNs;
+    head->swTxTs        = 1;
+
+    etcpMsgFecHdr_t* const fecHdr = (etcpMsgFecHdr_t* const)(head + 1);
+    memset(fecHdr,0,sizeof(etcpMsgFecHdr_t));
+    fecHdr->seqBase       = pg->groupId << conn->fecLog2;
+    fecHdr->groupSizeLog2 = conn->fecLog2;
+    fecHdr->urgent        = conn->isUrgent;
+    fecHdr->parityLen     = pg->len;
+    memcpy(fecHdr + 1,pg->__parity,pg->len);
+
+    const i64 msgSize = ethLen + sizeof(etcpMsgHead_t) + sizeof(etcpMsgFecHdr_t) + pg->len;
+    uint64_t hwTxTimeNs = 0;
+    etcpPort_t* const port = &state->ports[conn->txPort];
+    if_unlikely(etcpPortTx(port, buff, msgSize, &hwTxTimeNs, NULL, -1, -1) < 0){
+        WARN("Could not send parity for group at seq %li\n", fecHdr->seqBase);
+        return;
+    }
+    DBG("Sent parity for group at seq %li\n", fecHdr->seqBase);
+}
+
+
+//Collect a data packet that has just gone out for the first time into the parity for its group. When the group is
+//complete, send the parity. Groups are aligned to the group size, so a group that has a gap in it (eg because the TC sent
+//packets out of order) just never completes, and loss in it is recovered the normal way. Skip markers are left out, so
+//they are gaps too. A packet may be turned into one after it has gone into the parity, so the receiver never rebuilds from
+//a group with a skip in it (see etcpFecOnRxDat()), and there is no point sending parity for one.
+static inline void etcpFecOnTxDat(etcpConn_t* const conn, etcpState_t* const state, const pBuff_t* const pBuff)
+{
+    const etcpMsgDatHdr_t* const datHdr = pBuff->etcpDatHdr;
+    if_unlikely(datHdr->skipDat){
+        return; //No use to the receiver, see above
+    }
+
+    const i64 groupId   = datHdr->seqNum >> conn->fecLog2;
+    pgGroup_t* const pg = conn->fecTx;
+    if_unlikely(pg->groupId != groupId){
+        pgReset(pg,groupId);
+    }
+
+    const etcpFecDatSummary_t summary = etcpFecSummary(datHdr);
+    const i64 idx = datHdr->seqNum & ((1LL << conn->fecLog2) - 1);
+    const pgError_t err = pgAdd(pg,idx,&summary,sizeof(summary),pBuff->etcpPayload,datHdr->datLen);
+    if_unlikely(err != pgENOERR){
+        WARN("Could not add seq %li to parity group: %s\n", datHdr->seqNum, pgError2Str(err));
+        return;
+    }
+
+    if_unlikely(pg->count == (1LL << conn->fecLog2)){
+        etcpFecSendParity(conn,state,pg);
+        pgReset(pg,-1);
+    }
+}
+
+
+//Pick the next path to stripe a data packet onto, see etcpPath_t. Paths that haven't been measured yet are assumed to be as
+//good as the best one, so they get tried (and measured) straight away.
+static inline i64 etcpNextPath(etcpConn_t* const conn)
+{
+    i64 next      = 0;
+    i64 bestRttNs = INT64_MAX;
+    for(i64 i = 0; i < conn->pathCount; i++){
+        const etcpPath_t* const path = &conn->paths[i];
+        next      = path->pass < conn->paths[next].pass ? i : next;
+        bestRttNs = path->rtt.samples > 0 && path->rtt.srttNs < bestRttNs ? MAX(path->rtt.srttNs, 1) : bestRttNs;
+    }
+
+    etcpPath_t* const path = &conn->paths[next];
+    const i64 stride = path->rtt.samples > 0 ? MAX(path->rtt.srttNs, 1) : bestRttNs == INT64_MAX ? 1 : bestRttNs;
+    path->pass += stride;
+    return next;
+}
+
+
+//Tail loss probe, see etcpConn_t.tlpArmNs. Run this before the TC so that it can see the probe.
+void doEtcpTailProbe(etcpConn_t* const conn)
+{
+    if_eqlikely(conn->rtt.samples == 0 || conn->tlpSent){
+        return; //No RTT measured yet to base the timeout on (the TC's RTO covers this), or the probe is already out
+    }
+
+    const i64 ptoNs = 2 * conn->rtt.srttNs > ETCP_TLP_MIN_NS ? 2 * conn->rtt.srttNs : ETCP_TLP_MIN_NS;
+    const i64 timeNowNs = conn->state->nowNs;
+    if_likely(timeNowNs - conn->tlpArmNs < ptoNs){
+        return;
+    }
+
+    //Find the newest packet waiting for an ack
+    cq_t* const cq = conn->txQ;
+    for(i64 i = cq->rdMax - 1; i >= cq->rdMin; i--){
+        cqSlot_t* slot = NULL;
+        const cqError_t err = cqGetRd(cq,&slot,i);
+        if_eqlikely(err != cqENOERR){
+            continue; //Already ack'd
         }
-        else if_unlikely(err != etcpENOERR){
-            ERR("Unexpected error making ack packet\n");
-            return err;
+
+        pBuff_t* const pbuff = slot->buff;
+        if_unlikely(pbuff->etcpDatHdr->txAttempts == 0){
+            return; //There's still new data to go, which will do the job of a probe
         }
 
-        //Account for the now sent messages by updating the seqAck value, only do so up to the edge of the first field, this
-        //is the limit that will be receivable until new packets come.
-        conn->seqAck = conn->seqAck + sackFields[0].offset + sackFields[0].count;
+        DBG("Tail loss probe for seq %li, nothing heard for %lins\n", i, timeNowNs - conn->tlpArmNs);
+        pbuff->probe  = true;
+        conn->tlpSent = true;
+        etcpTcEvt(conn,etcpTC_PROBE,i,1,timeNowNs);
+        return;
     }
-    return etcpENOERR;
-
 }
 
 
-etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i64 maxSlots )
+etcpError_t doEtcpNetTx(etcpConn_t* const conn, etcpState_t* const state, const i64 maxSlots )
 {
+    cq_t* const cq = conn->txQ;
     cqSlot_t* slot = NULL;
+    const i64 timeNowNs = state->nowNs;
 
-
-    for(i64 i = cq->rdMin; i < cq->rdMax && i < cq->rdMin + maxSlots; i++){
+    const i64 txEnd = maxSlots < cq->rdMax - cq->rdMin ? cq->rdMin + maxSlots : cq->rdMax; //maxSlots may be INT64_MAX
+    for(i64 i = cq->rdMin; i < txEnd; i++){
         const cqError_t err = cqGetRd(cq,&slot,i);
         if_eqlikely(err == cqEWRONGSLOT){
             //The slot is empty
@@ -788,17 +1521,48 @@ etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i6
         //We've now got a valid slot with a packet in it, grab it and see if the TC has decided it should be sent?
         pBuff_t* const pBuff = slot->buff;
 
+        //Messages with a deadline are dropped here as soon as it passes, regardless of what the TC has to say about them
+        if_unlikely(pBuff->deadlineNs != ETCP_NO_DEADLINE && pBuff->etcpHdr->type == ETCP_DAT && !pBuff->etcpDatHdr->skipDat){
+            if(timeNowNs > pBuff->deadlineNs){
+                DBG("Deadline expired for seq/slot %li by %lins\n", i, timeNowNs - pBuff->deadlineNs);
+                pBuff->txState = ETCP_TX_DRP;
+            }
+        }
+
+        //With the event driven TC, the stack decides what is ready itself. Packets that the TC wants resent have been marked
+        //already, see doEtcpTxEvtTc().
+        if_unlikely(etcpTxTcIsEvt(state) && pBuff->txState == ETCP_TX_RDY){
+            const bool ready = pBuff->etcpHdr->type != ETCP_DAT || pBuff->etcpDatHdr->txAttempts == 0 || pBuff->lost || pBuff->probe;
+            if_eqlikely(!ready){
+                continue; //Waiting for an ack
+            }
+            pBuff->txState = ETCP_TX_NOW;
+        }
+
         if_eqlikely(pBuff->txState == ETCP_TX_DRP ){
-            //We're told to drop the packet. Release it and continue
-            WARN("Dropping seq/slot %li\n", i);
-            cqReleaseSlot(cq,i);
-            continue;
+            //We're told to drop the packet. Acks can just be released, but the receiver is (or soon will be) waiting on a
+            //data packet, so tell it to skip the gap instead.
+            if_eqlikely(pBuff->etcpHdr->type != ETCP_DAT || pBuff->etcpDatHdr->skipDat){
+                WARN("Dropping seq/slot %li\n", i);
+                cqReleaseSlot(cq,i);
+                continue;
+            }
+
+            DBG("Dropping seq/slot %li, sending skip marker\n", i);
+            etcpDatToSkip(pBuff);
+            pBuff->txState = ETCP_TX_NOW;
         }
         else if_unlikely(pBuff->txState != ETCP_TX_NOW ){
             WARN("Ingnoring seq/slot %li waiting for ack\n", i);
             continue; //Not ready to send this packet now.
         }
 
+        //The receiver has no room for this, or anything after it, yet. It stays ready to go once an ack opens the window up.
+        if_unlikely(i >= conn->txEdge && pBuff->etcpHdr->type == ETCP_DAT){
+            DBG("Holding seq/slot %li and after, the receiver's window ends at %li\n", i, conn->txEdge);
+            break;
+        }
+
         //before the packet is sent, make it ready to send again in the future just in case something goes wrong
         pBuff->txState = ETCP_TX_RDY;
 
@@ -806,22 +1570,19 @@ etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i6
 
         switch(pBuff->etcpHdr->type){
             case ETCP_DAT:{
+                //Resends (lost packets, timeouts and probes) are only sent because we're waiting on an ack, so don't let the
+                //receiver hold it back
+                pBuff->etcpDatHdr->ackNow = pBuff->etcpDatHdr->txAttempts > 0 || pBuff->probe;
                 if_likely(pBuff->etcpDatHdr->txAttempts == 0){
                     //Only put the timestamp in on the first time we send a data packet so we know how long it spends RTT incl
                     //in the txq.
                     //Would be nice to have an extra timestamp slot so that the local queueing time could be accounted for as well.
-                    struct timespec ts = {0};
-                    clock_gettime(CLOCK_REALTIME,&ts);
-                    const i64 timeNowNs = ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
                     pBuff->etcpHdr->ts.swTxTimeNs = timeNowNs;
                     pBuff->etcpHdr->swTxTs        = 1;
                 }
                 break;
             }
             case ETCP_ACK:{
-                struct timespec ts = {0};
-                clock_gettime(CLOCK_REALTIME,&ts);
-                const i64 timeNowNs = ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
                 pBuff->etcpHdr->ts.swTxTimeNs = timeNowNs;
                 pBuff->etcpHdr->swTxTs        = 1;
                 break;
@@ -833,12 +1594,30 @@ etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i6
         }
 
 
+        //Striped connections spread their data packets (including retransmissions) over their paths
+        i64 txPort = conn->txPort;
+        if_unlikely(conn->pathCount > 0 && pBuff->etcpHdr->type == ETCP_DAT){
+            pBuff->txPath = etcpNextPath(conn);
+            txPort        = conn->paths[pBuff->txPath].port;
+        }
+
         uint64_t hwTxTimeNs = 0;
         const pBuff_t* const pbuff = slot->buff;
-        if_unlikely(state->ethHwTx(state->ethHwState, pBuff->buffer, pbuff->msgSize, &hwTxTimeNs) < 0){
+        etcpPort_t* const port = &state->ports[txPort];
+        const bool isDat = pBuff->etcpHdr->type == ETCP_DAT;
+        if_unlikely(etcpPortTx(port, pBuff->buffer, pbuff->msgSize, &hwTxTimeNs, isDat ? conn : NULL, i, conn->txOrder) < 0){
             return etcpETRYAGAIN;
         }
 
+        //Redundant transmission. The first copy is already on its way, so the second is best effort.
+        if_unlikely(conn->dupPort >= 0 && isDat){
+            etcpPort_t* const dupPort = &state->ports[conn->dupPort];
+            uint64_t dupTxTimeNs = 0;
+            if_unlikely(etcpPortTx(dupPort, pBuff->buffer, pbuff->msgSize, &dupTxTimeNs, NULL, -1, -1) < 0){
+                WARN("Could not send duplicate of seq/slot %li on port %li\n", i, conn->dupPort);
+            }
+        }
+
         DBG("Sent packet %li\n", i);
 
         switch(pBuff->etcpHdr->type){
@@ -846,13 +1625,27 @@ etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i6
                 //The exanics do not yet support inline HW tx timestamping, but we can kind of fake it here
                 //XXX HACK - not sure what a generic way to do this is?
                 if_likely(pBuff->etcpDatHdr->txAttempts == 0){
-                    pBuff->etcpHdr->ts.hwTxTimeNs = hwTxTimeNs;
-                    pBuff->etcpHdr->hwTxTs        = 1;
+                    if_likely(port->ethHwTxTs == NULL){ //Otherwise it turns up later, see etcpOnTxTs()
+                        pBuff->etcpHdr->ts.hwTxTimeNs = hwTxTimeNs;
+                        pBuff->etcpHdr->hwTxTs        = 1;
+                    }
+
+                    if_unlikely(conn->fecLog2 != 0){
+                        etcpFecOnTxDat(conn,state,pBuff);
+                    }
+                    conn->txOutstanding++;
+                    conn->txSeqSent = MAX(conn->txSeqSent, i + 1);
                 }
+                conn->txLost -= pBuff->lost;
                 pBuff->etcpDatHdr->txAttempts++; //Keep this around for next time.
+                pBuff->txOrder = conn->txOrder++;
+                pBuff->lost    = false;
+                pBuff->probe   = false;
+                conn->tlpArmNs = timeNowNs;
                 if_eqlikely(pBuff->etcpDatHdr->noAck){
                     //We're done with the packet, not expecting an ack, so drop it now
                     cqReleaseSlot(cq,i);
+                    conn->txOutstanding--;
                 }
                 //Otherwise, we need to wait for the packet to be ack'd
                 break;
@@ -879,6 +1672,57 @@ etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i6
 
 
 
+//Collect the TX timestamps that have completed on a port, and put them into the packets they belong to, just as if they
+//had come back from ethHwTx() straight away. Only the first transmission of a data packet is timestamped.
+static inline void etcpOnTxTs(etcpPort_t* const port, const i64 portIdx)
+{
+    int64_t txId = -1;
+    uint64_t hwTxTimeNs = 0;
+    int64_t result = port->ethHwTxTs(port->ethHwState, &txId, &hwTxTimeNs);
+    for(; result > 0; result = port->ethHwTxTs(port->ethHwState, &txId, &hwTxTimeNs)){
+        etcpTxPending_t* const pending = &port->txPending[txId & ((1 << ETCP_TX_PENDING_LOG2) - 1)];
+        if_unlikely(pending->txId != txId || pending->conn == NULL){
+            continue; //Too late, the entry has been reused. Or no one wanted this one.
+        }
+        etcpConn_t* const conn = pending->conn;
+        pending->conn = NULL;
+
+        cqSlot_t* slot = NULL;
+        if_eqlikely(cqGetRd(conn->txQ,&slot,pending->seq) != cqENOERR){
+            continue; //Already ack'd
+        }
+
+        pBuff_t* const pbuff = slot->buff;
+        if_unlikely(pbuff->txOrder != pending->txOrder || pbuff->etcpDatHdr->txAttempts != 1){
+            continue; //The slot has been reused, or the packet has been sent again since
+        }
+
+        pbuff->etcpHdr->ts.hwTxTimeNs = etcpPortHwToSw(port, hwTxTimeNs);
+        pbuff->etcpHdr->hwTxTs        = 1;
+    }
+
+    if_unlikely(result < 0){
+        WARN("Tx timestamp error %li on port %li\n", result, portIdx);
+    }
+}
+
+
+//Take a pair of hardware and software clock readings for the port's clock model
+static inline void etcpOnHwClk(etcpPort_t* const port, const i64 portIdx)
+{
+    uint64_t hwTimeNs = 0;
+    int64_t swTimeNs  = 0;
+    int64_t errNs     = 0;
+    const int64_t result = port->ethHwClk(port->ethHwState, &hwTimeNs, &swTimeNs, &errNs);
+    if_likely(result > 0){
+        cmSample(&port->hwClock, hwTimeNs, swTimeNs, MAX(errNs, 0));
+    }
+    else if_unlikely(result < 0){
+        WARN("Hardware clock error %li on port %li\n", result, portIdx);
+    }
+}
+
+
 //Returns the number of packets received
 i64 doEtcpNetRx(etcpState_t* state)
 {
@@ -893,21 +1737,42 @@ i64 doEtcpNetRx(etcpState_t* state)
     pbuff->buffSize = MAX_FRAME - sizeof(pbuff);
     assert(pbuff->buffSize > 0);
 
-    uint64_t hwRxTimeNs = 0;
-    i64 rxLen = state->ethHwRx(state->ethHwState,pbuff->buffer,pbuff->buffSize, &hwRxTimeNs);
-    pbuff->msgSize = rxLen;
-    for(; rxLen > 0; rxLen = state->ethHwRx(state->ethHwState,pbuff->buffer,pbuff->buffSize,&hwRxTimeNs)){
+    etcpStateTick(state);
+
+    //Packets for any connection can turn up on any port
+    for(i64 portIdx = 0; portIdx < state->portCount; portIdx++){
+        etcpPort_t* const port = &state->ports[portIdx];
+
+        if_unlikely(port->ethHwClk != NULL && (port->rxPolls++ & (ETCP_HWCLK_POLLS - 1)) == 0){
+            etcpOnHwClk(port, portIdx);
+        }
+
+        if_unlikely(port->ethHwTxTs != NULL){
+            etcpOnTxTs(port, portIdx);
+        }
+
+        uint64_t hwRxTimeNs = 0;
+        i64 rxLen = port->ethHwRx(port->ethHwState,pbuff->buffer,pbuff->buffSize, &hwRxTimeNs);
         pbuff->msgSize = rxLen;
-        etcpError_t err = etcpOnRxEthernetFrame(state, pbuff, hwRxTimeNs);
-        result++;
-        if_unlikely(err == etcpETRYAGAIN){
-            WARN("Ring is full\n");
-            break;
+        for(; rxLen > 0; rxLen = port->ethHwRx(port->ethHwState,pbuff->buffer,pbuff->buffSize,&hwRxTimeNs)){
+            pbuff->msgSize = rxLen;
+            const uint64_t hwRxSwNs = etcpPortHwToSw(port, hwRxTimeNs);
+            //The frame came in after the poll started, the software time can't be before it. Without a hardware clock the
+            //time is the NIC's own, which can't be compared (and 0 means the clock model isn't ready yet).
+            if_unlikely(port->ethHwClk != NULL && (i64)hwRxSwNs > state->nowNs){
+                etcpStateTick(state);
+            }
+            etcpError_t err = etcpOnRxEthernetFrame(state, pbuff, hwRxSwNs);
+            result++;
+            if_unlikely(err == etcpETRYAGAIN){
+                WARN("Ring is full\n");
+                break;
+            }
         }
-    }
 
-    if(rxLen < 0){
-        WARN("Rx error %li\n", rxLen);
+        if(rxLen < 0){
+            WARN("Rx error %li on port %li\n", rxLen, portIdx);
+        }
     }
 
     return result;
@@ -916,14 +1781,20 @@ i64 doEtcpNetRx(etcpState_t* state)
 
 
 //This is a user facing function
-etcpError_t doEtcpUserRx(etcpConn_t* const conn, void* __restrict data, i64* const len_io)
+etcpError_t doEtcpUserRx(etcpConn_t* const conn, const i64 streamId, void* __restrict data, i64* const len_io)
 {
+    etcpStream_t* const stream = etcpConnStream(conn,streamId);
+    if_unlikely(stream == NULL){
+        WARN("Stream %li has not been opened\n", streamId);
+        return etcpERANGE;
+    }
 
     //DBG("Doing user rx\n");
     while(1){
-        i64 seqNum = -1;
-        cqSlot_t* slot;
-        cqError_t cqErr = cqGetNextRd(conn->rxQ,&slot,&seqNum);
+        //The next packet in stream order tells us which packet in the connection window to look at
+        i64 streamSeqNum = -1;
+        cqSlot_t* idxSlot;
+        cqError_t cqErr = cqGetNextRd(stream->rxQ,&idxSlot,&streamSeqNum);
         if_unlikely(cqErr == cqENOSLOT){
             //Nothing here. Give up
             return etcpETRYAGAIN;
@@ -932,6 +1803,14 @@ etcpError_t doEtcpUserRx(etcpConn_t* const conn, void* __restrict data, i64* con
             ERR("Error on circular buffer: %s\n", cqError2Str(cqErr));
             return etcpECQERR;
         }
+        const i64 seqNum = *(i64*)idxSlot->buff;
+
+        cqSlot_t* slot;
+        cqErr = cqGetRd(conn->rxQ,&slot,seqNum);
+        if_unlikely(cqErr != cqENOERR){
+            ERR("Stream %li seq %li points at seq %li, but it is not there: %s\n", streamId, streamSeqNum, seqNum, cqError2Str(cqErr));
+            return etcpECQERR;
+        }
         //DBG("Got packet with sequence number %li\n",seqNum);
 
 
@@ -939,29 +1818,39 @@ etcpError_t doEtcpUserRx(etcpConn_t* const conn, void* __restrict data, i64* con
         const etcpMsgDatHdr_t* const datHdr =  pbuff->etcpDatHdr;
 
         //We have a valid packet, but it might be stale, or not yet ack'd
-        if(!datHdr->ackSent){
+        if(!bmGet(conn->rxAcked,seqNum)){
             //DBG("Packet has not been ack'd\n");
             return etcpETRYAGAIN; //Ack has not yet been made for this, cannot give over to the user until it has
         }
 
-        if(datHdr->staleDat){
-            DBG("Releasing stale packet\n");
-            cqReleaseSlot(conn->rxQ,seqNum);
-            continue; //The packet is stale, so release it, but get another one
+        if(datHdr->staleDat || datHdr->skipDat){
+            DBG("Releasing stale/skipped packet\n");
+            etcpRxRelease(conn,seqNum);
+            cqReleaseSlot(stream->rxQ,streamSeqNum);
+            continue; //The packet is stale or was abandoned by the sender, so release it, but get another one
         }
 
         const i8* dat = (i8*)(datHdr + 1);
 
-        //Looks ok, give the data over to the user
-        memcpy(data,dat,MIN(datHdr->datLen,*len_io));
+        //Looks ok, give the data over to the user. The stack is done with bulk data now, so it is streamed rather than pushing
+        //the headers and slots of the urgent lane out of the cache. Urgent data is small, and the user wants it now.
+        if_unlikely(conn->isUrgent){
+            fcCopy(data,dat,MIN(datHdr->datLen,*len_io));
+        }
+        else{
+            fcCopyStream(data,dat,MIN(datHdr->datLen,*len_io));
+        }
 
-        cqErr = cqReleaseSlot(conn->rxQ,seqNum);
-        if(cqErr != cqENOERR){
+        //Slots in the connection window can be released out of order, the read pointer only moves once all of the slots
+        //before it (on any stream) have been released too.
+        cqErr = etcpRxRelease(conn,seqNum);
+        if(cqErr != cqENOERR && cqErr != cqENOCHANGE){
             WARN("Unexpected error releasing slot %li: %s\n", seqNum, cqError2Str(cqErr));
             return etcpECQERR;
         }
+        cqReleaseSlot(stream->rxQ,streamSeqNum);
 
-        DBG("Packet with seq=%li and len=%li given to user\n", seqNum, *len_io);
+        DBG("Packet with seq=%li and len=%li given to user on stream %li\n", seqNum, *len_io, streamId);
         //We've copied a valid packet and released it, the user can have it now
         DBG("New rd_min=%li, wr_max=%li\n", conn->rxQ->rdMin, conn->rxQ->wrMax);
         return etcpENOERR;
@@ -973,9 +1862,15 @@ etcpError_t doEtcpUserRx(etcpConn_t* const conn, void* __restrict data, i64* con
 
 //Assumes ethernet packets, does in-place construction of a packet and puts it into the circular queue ready to send
 //This is a user facing function
-etcpError_t doEtcpUserTx(etcpConn_t* const conn, const void* const toSendData, i64* const toSendLen_io)
+etcpError_t doEtcpUserTx(etcpConn_t* const conn, const i64 streamId, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs)
 
 {
+    etcpStream_t* const stream = etcpConnStream(conn,streamId);
+    if_unlikely(stream == NULL){
+        WARN("Stream %li has not been opened\n", streamId);
+        return etcpERANGE;
+    }
+
     //DBG("Doing user tx, with %li bytes to send\n", *toSendLen_io);
     const i64 toSendLen = *toSendLen_io;
     i64 bytesSent = 0;
@@ -1030,8 +1925,6 @@ etcpError_t doEtcpUserTx(etcpConn_t* const conn, const void* const toSendData, i
         const i64 datLen   = MIN(datSpace,toSendLen);
         pBuff->msgSize    += hdrsLen;
 
-        struct timespec ts = {0};
-        clock_gettime(CLOCK_REALTIME,&ts);
         etcpMsgHead_t* const head = (etcpMsgHead_t* const)buff;
         pBuff->etcpHdr = head;
         pBuff->etcpHdrSize = sizeof(etcpMsgHead_t);
@@ -1039,7 +1932,7 @@ etcpError_t doEtcpUserTx(etcpConn_t* const conn, const void* const toSendData, i
         head->fulltype      = ETCP_V1_FULLHEAD(ETCP_DAT);
         head->srcPort       = conn->flowId.srcPort;
         head->dstPort       = conn->flowId.dstPort;
-        head->ts.swTxTimeNs = ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+        head->ts.swTxTimeNs = conn->state->nowNs;
 
         etcpMsgDatHdr_t* const datHdr = (etcpMsgDatHdr_t* const)(head + 1);
         pBuff->etcpDatHdr     = datHdr;
@@ -1050,15 +1943,26 @@ etcpError_t doEtcpUserTx(etcpConn_t* const conn, const void* const toSendData, i
         pBuff->msgSize    += datLen;
         datHdr->seqNum     = conn->seqSnd;
         datHdr->txAttempts = 0;
+        datHdr->skipDat    = 0;
+        datHdr->urgent     = conn->isUrgent;
+        datHdr->fecLog2    = conn->fecLog2;
+        datHdr->dupTx      = conn->dupPort >= 0;
+        datHdr->streamId   = streamId;
+        datHdr->streamSeq  = stream->seqSnd;
 
         void* const msgDat = (void* const)(datHdr + 1);
         pBuff->etcpPayload = msgDat;
         pBuff->etcpPayloadSize = sizeof(datLen);
 
         //DBG("Copying %li payload to data\n", datLen);
-        memcpy(msgDat,toSendData,datLen);
+        fcCopy(msgDat,toSendData,datLen);
 
-        pBuff->txState = ETCP_TX_RDY; //Packet is ready to be sent, subject to Transmission Control.
+        pBuff->txState    = ETCP_TX_RDY; //Packet is ready to be sent, subject to Transmission Control.
+        pBuff->deadlineNs = deadlineNs;
+        pBuff->txPath     = -1;
+        pBuff->txOrder    = -1;
+        pBuff->lost       = false;
+        pBuff->probe      = false;
 
         //At this point, the packet is now ready to send!
         const i64 totalLen = ethLen + hdrsLen + datLen;
@@ -1070,6 +1974,8 @@ etcpError_t doEtcpUserTx(etcpConn_t* const conn, const void* const toSendData, i
 
         bytesSent += datLen;
         conn->seqSnd++;
+        stream->seqSnd++;
+        etcpTcEvt(conn,etcpTC_QUEUED,seqNum,1,conn->state->nowNs);
 
     }
 
@@ -15,13 +15,16 @@
 #include "etcpState.h"
 #include "etcpConn.h"
 
-etcpError_t doEtcpUserTx(etcpConn_t* const conn, const void* const toSendData, i64* const toSendLen_io);
-etcpError_t doEtcpUserRx(etcpConn_t* const conn, void* __restrict data, i64* const len_io);
+etcpError_t doEtcpUserTx(etcpConn_t* const conn, const i64 streamId, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs);
+etcpError_t doEtcpUserRx(etcpConn_t* const conn, const i64 streamId, void* __restrict data, i64* const len_io);
 
-etcpError_t doEtcpNetTx(cq_t* const cq, const etcpState_t* const state, const i64 maxSlots );
+etcpError_t doEtcpNetTx(etcpConn_t* const conn, etcpState_t* const state, const i64 maxSlots );
+void doEtcpTailProbe(etcpConn_t* const conn);
 i64 doEtcpNetRx(etcpState_t* state);
 etcpError_t generateAcks(etcpConn_t* const conn, const i64 maxAckPackets, const i64 maxSlots);
 etcpError_t generateStaleAcks(etcpConn_t* const conn, const i64 maxAckPackets, const i64 maxSlots);
+void doEtcpTxEvtTc(etcpState_t* const state, etcpConn_t* const sendConn, const etcpConn_t* const recvConn, bool* const ackFirst_o, i64* const maxAck_o, i64* const maxDat_o);
+void doEtcpAckPolicy(const etcpConn_t* const conn, const etcpAckPolicy_t* const policy, i64* const maxAckSlots_o, i64* const maxAckPkts_o,  i64* const maxStaleSlots_o,  i64* const maxStaleAckPkts_o);
 
 
 #endif /* SRC_ETCP_H_ */
@@ -15,6 +15,8 @@
 #include "utils.h"
 #include "debug.h"
 #include "etcpConn.h"
+#include "etcpState.h"
+#include "packets.h"
 
 
 void etcpConnDelete(etcpConn_t* const conn)
@@ -23,14 +25,35 @@ void etcpConnDelete(etcpConn_t* const conn)
 
     if_likely(conn->txQ != NULL){ cqDelete(conn->txQ); }
     if_likely(conn->rxQ != NULL){ cqDelete(conn->rxQ); }
+    if_likely(conn->rxRcvd != NULL){ bmDelete(conn->rxRcvd); }
+    if_likely(conn->rxAcked != NULL){ bmDelete(conn->rxAcked); }
     if_likely(conn->staleQ != NULL){ llDelete(conn->staleQ); }
+    if_likely(conn->urgent != NULL){ etcpConnDelete(conn->urgent); }
+
+    for(i64 i = 0; i < ETCP_MAX_STREAMS; i++){
+        if_likely(conn->streams[i] == NULL){ continue; }
+        cqDelete(conn->streams[i]->rxQ);
+        free(conn->streams[i]);
+    }
+
+    etcpConnFec(conn,0);
+
+    //TX timestamps still on their way for this connection have nowhere to go now
+    for(i64 portIdx = 0; conn->state != NULL && portIdx < conn->state->portCount; portIdx++){
+        etcpPort_t* const port = &conn->state->ports[portIdx];
+        for(i64 i = 0; port->ethHwTxTs != NULL && i < (1 << ETCP_TX_PENDING_LOG2); i++){
+            if_unlikely(port->txPending[i].conn == conn){
+                port->txPending[i].conn = NULL;
+            }
+        }
+    }
 
     free(conn);
 
 }
 
 
-etcpConn_t* etcpConnNew(etcpState_t* const state, const i64 windowSizeLog2, const i32 buffSize, const uint32_t srcAddr, const uint32_t srcPort, const uint64_t dstAddr, const uint32_t dstPort, const i64 vlan, const i64 priority)
+static etcpConn_t* connNew(etcpState_t* const state, const i64 windowSizeLog2, const i32 buffSize, const uint32_t srcAddr, const uint32_t srcPort, const uint64_t dstAddr, const uint32_t dstPort, const i64 vlan, const i64 priority, const bool isUrgent)
 {
     etcpConn_t* conn = calloc(1, sizeof(etcpConn_t));
     if_unlikely(!conn){ return NULL; }
@@ -47,12 +70,25 @@ etcpConn_t* etcpConnNew(etcpState_t* const state, const i64 windowSizeLog2, cons
         return NULL;
     }
 
+    conn->rxRcvd  = bmNew(windowSizeLog2);
+    conn->rxAcked = bmNew(windowSizeLog2);
+    if_unlikely(conn->rxRcvd == NULL || conn->rxAcked == NULL){
+        etcpConnDelete(conn);
+        return NULL;
+    }
+
     conn->staleQ = llNew(buffSize);
     if_unlikely(conn->staleQ == NULL){
         etcpConnDelete(conn);
         return NULL;
     }
 
+    //Stream 0 is always there, the others have to be opened, see etcpConnStreamOpen()
+    if_unlikely(etcpConnStreamOpen(conn,0) == NULL){
+        etcpConnDelete(conn);
+        return NULL;
+    }
+
 
     conn->flowId.srcAddr = srcAddr;
     conn->flowId.srcPort = srcPort;
@@ -61,8 +97,123 @@ etcpConn_t* etcpConnNew(etcpState_t* const state, const i64 windowSizeLog2, cons
 
     conn->state = state;
 
-    conn->vlan     = vlan;
-    conn->priority = priority;
+    conn->vlan         = vlan;
+    conn->priority     = priority;
+    conn->isUrgent     = isUrgent;
+    conn->txPort       = 0;
+    conn->dupPort      = -1;
+    conn->txOrderAcked = -1;
+    rttReset(&conn->rtt,ETCP_RTT_WIN_NS);
+    coReset(&conn->peerClock,ETCP_CLOCK_PERIOD_NS);
+    conn->rxEdgeSent   = conn->rxQ->wrMax;
+    conn->txEdge       = conn->txQ->rdMin + MIN(ETCP_TX_INITIAL_WINDOW, conn->txQ->__slotCount); //No more than we can hold
+    conn->txSeqSent    = conn->txQ->rdMin;
+    conn->tcTimerNs    = -1;
+
+    return conn;
+}
+
+
+etcpConn_t* etcpConnNew(etcpState_t* const state, const i64 windowSizeLog2, const i32 buffSize, const uint32_t srcAddr, const uint32_t srcPort, const uint64_t dstAddr, const uint32_t dstPort, const i64 vlan, const i64 priority)
+{
+    etcpConn_t* const conn = connNew(state,windowSizeLog2,buffSize,srcAddr,srcPort,dstAddr,dstPort,vlan,priority,false);
+    if_unlikely(!conn){ return NULL; }
+
+    const i64 urgentWindowLog2 = MIN(windowSizeLog2, ETCP_URGENT_WINDOW_LOG2);
+    conn->urgent = connNew(state,urgentWindowLog2,buffSize,srcAddr,srcPort,dstAddr,dstPort,vlan,priority,true);
+    if_unlikely(conn->urgent == NULL){
+        etcpConnDelete(conn);
+        return NULL;
+    }
 
     return conn;
 }
+
+
+etcpStream_t* etcpConnStream(const etcpConn_t* const conn, const i64 streamId)
+{
+    if_unlikely(streamId < 0 || streamId >= ETCP_MAX_STREAMS){
+        WARN("Stream id %li is out of range, max is %li\n", streamId, ETCP_MAX_STREAMS - 1);
+        return NULL;
+    }
+
+    return conn->streams[streamId];
+}
+
+
+etcpStream_t* etcpConnStreamOpen(etcpConn_t* const conn, const i64 streamId)
+{
+    if_unlikely(streamId < 0 || streamId >= ETCP_MAX_STREAMS){
+        WARN("Stream id %li is out of range, max is %li\n", streamId, ETCP_MAX_STREAMS - 1);
+        return NULL;
+    }
+
+    if_unlikely(conn->streams[streamId] != NULL){
+        return conn->streams[streamId];
+    }
+
+    etcpStream_t* const stream = calloc(1, sizeof(etcpStream_t));
+    if_unlikely(!stream){ return NULL; }
+
+    //A stream can never have more packets outstanding than the connection, so the same window size is always enough
+    stream->rxQ = cqNew(sizeof(i64),conn->rxQ->__slotCountLog2);
+    if_unlikely(stream->rxQ == NULL){
+        free(stream);
+        return NULL;
+    }
+
+    conn->streams[streamId] = stream;
+    return stream;
+}
+
+
+etcpError_t etcpConnFec(etcpConn_t* const conn, const i64 fecLog2)
+{
+    if_unlikely(fecLog2 < 0 || fecLog2 > PG_MAX_GROUP_LOG2){
+        WARN("FEC group size (log2) %li is out of range, max is %li\n", fecLog2, PG_MAX_GROUP_LOG2);
+        return etcpERANGE;
+    }
+
+    pgDelete(conn->fecTx);
+    conn->fecTx = NULL;
+    for(i64 i = 0; i < ETCP_FEC_RX_GROUPS; i++){
+        pgDelete(conn->fecRx[i]);
+        conn->fecRx[i] = NULL;
+    }
+    free(conn->fecFrame);
+    conn->fecFrame     = NULL;
+    conn->fecFrameSize = 0;
+    conn->fecLog2      = 0;
+
+    if_eqlikely(fecLog2 == 0){
+        return etcpENOERR;
+    }
+
+    //Both queues carry the same sized slots, so either will do for the biggest payload
+    const i64 maxParity = sizeof(etcpFecDatSummary_t) + conn->rxQ->slotDataSize;
+
+    conn->fecTx = pgNew(maxParity);
+    if_unlikely(conn->fecTx == NULL){
+        etcpConnFec(conn,0);
+        return etcpENOMEM;
+    }
+
+    for(i64 i = 0; i < ETCP_FEC_RX_GROUPS; i++){
+        conn->fecRx[i] = pgNew(maxParity);
+        if_unlikely(conn->fecRx[i] == NULL){
+            etcpConnFec(conn,0);
+            return etcpENOMEM;
+        }
+    }
+
+    //Big enough for either a whole parity packet or a whole rebuilt data packet (with its pBuff header)
+    conn->fecFrameSize = sizeof(pBuff_t) + ETCP_ETH_OVERHEAD + sizeof(etcpMsgHead_t) + sizeof(etcpMsgDatHdr_t) + maxParity;
+    conn->fecFrame     = calloc(1,conn->fecFrameSize);
+    if_unlikely(conn->fecFrame == NULL){
+        etcpConnFec(conn,0);
+        return etcpENOMEM;
+    }
+
+    conn->fecLog2 = fecLog2;
+    return etcpENOERR;
+}
@@ -11,13 +11,48 @@
 #define SRC_ETCPCONN_H_
 
 
+#include <stdbool.h>
+
 #include "types.h"
 #include "etcpConn.h"
 #include "CircularQueue.h"
 #include "LinkedList.h"
+#include "ParityGroup.h"
+#include "Bitmap.h"
+#include "RttEstimator.h"
+#include "ClockOffset.h"
+#include "etcpState.h"
 
 typedef struct etcpState_s etcpState_t;
 
+#define ETCP_URGENT_WINDOW_LOG2 (3) //Urgent messages are few and small, 8 slots is plenty
+#define ETCP_TX_INITIAL_WINDOW (16LL) //Packets the sender assumes the receiver has room for, until the first ack says otherwise
+#define ETCP_MAX_STREAMS (64)
+#define ETCP_FEC_RX_GROUPS (4) //Parity groups collected at once on the rx side. Must be a power of 2
+#define ETCP_MAX_PATHS (4) //One per port is enough
+#define ETCP_RTT_WIN_NS (10LL * 1000 * 1000 * 1000) //How far back the min/max RTT look, long enough to see past a busy spell
+#define ETCP_CLOCK_PERIOD_NS (100LL * 1000 * 1000) //How often the peer clock offset is taken from a fresh sample
+#define ETCP_REORDER_THRESH (3) //A packet is presumed lost once a packet sent this many transmissions after it is ack'd
+#define ETCP_TLP_MIN_NS (10 * 1000) //Shortest tail loss probe timeout, so that a tiny RTT doesn't turn probes into a flood
+
+//A stream is an ordering domain inside a connection. Streams share everything else with the connection (flow, header
+//template, tx/rx queues, sequence space, acks and TC). The receiver keeps a small per stream receive queue, indexed by
+//stream sequence number, where each slot holds the connection sequence number of the packet, so a lost packet only
+//holds up delivery on its own stream.
+typedef struct {
+    cq_t* rxQ;  //Stream receive queue. Slots hold the (i64) connection sequence number of the packet in the connection rxQ
+    i64 seqSnd; //The current stream send sequence number
+} etcpStream_t;
+
+//A path is a port that a connection stripes its data packets over. Paths are picked by stride scheduling: the path with the
+//lowest pass goes next, then its pass moves on by its smoothed RTT. So each path gets a share of the packets in proportion
+//to 1/RTT, and a path that starts queueing (or is just further away) gets less.
+typedef struct {
+    i64 port;     //Port this path sends on
+    rttEst_t rtt; //RTT of data packets sent on this path, the same estimates as the connection's (see etcpConn_t.rtt)
+    i64 pass;     //Stride scheduler position
+} etcpPath_t;
+
 typedef struct  __attribute__((packed)){
     i32 dstPort;
     i32 srcPort;
@@ -35,12 +70,75 @@ struct etcpConn_s {
 
     cq_t* rxQ; //Queue for incoming packets
     cq_t* txQ; //Queue for outgoing packets
+
+    //One bit per rxQ slot, so that acks can be made by scanning a word (64 packets) at a time instead of walking the slots.
+    //rxRcvd is set once a packet has arrived, rxAcked once it has been acked (or doesn't need to be). Slots can be released
+    //out of order, so the bits stay set until the read pointer moves past the slot, see etcpRxRelease().
+    bm_t* rxRcvd;
+    bm_t* rxAcked;
+
+    //For the built-in ack coalescing, see etcpAckPolicy_t
+    i64 ackWaiting;   //Packets received that are still waiting for an ack
+    i64 ackWaitingNs; //When the oldest of them arrived
+    bool ackNowReq;   //One of them has ackNow set
+    i64 rxSeqHi;      //One past the highest sequence number received
+
+    //Flow control. The receiver advertises the end of its rx window in every ack (see rxWindowSegs), and the sender doesn't
+    //send data beyond it, so a slow reader pushes back on the sender rather than having packets dropped and resent.
+    i64 rxEdgeSent; //Receive side: the end of the window in the last ack sent
+    i64 txEdge;     //Send side: the end of the receiver's window from the latest ack, see ETCP_TX_INITIAL_WINDOW before that
+
     ll_t* staleQ; //An ordered list for holding stale packets that have missed the sequence number RX window.
     i64 lastTxIdx;
 
-    i64 seqAck; //The current acknowledge sequence number
+    i64 seqAck; //Everything below this has been ack'd
     i64 seqSnd; //The current send sequence number
 
+    i64 txOrder;      //Number of data transmissions (incl. retransmissions) so far
+    i64 txOrderAcked; //The latest transmission that has been ack'd, -1 if none
+    rttEst_t rtt;     //RTT of data packets on this connection. Given to the TX TC, so that it doesn't have to work it out
+    etcpLatRing_t lat; //Where the time went on the latest round trips, see etcpLatency_t. Also given to the TX TC
+    coEst_t peerClock; //The remote end's software clock against ours, for the one way delays in the latency records
+
+    //For the event driven TX TC, see etcpTxEvtTc_f. The counts are kept whichever TC there is, the events only with that one.
+    i64 txSeqSent;     //One past the newest data packet sent
+    i64 txOutstanding; //Data packets sent and not ack'd yet
+    i64 txLost;        //Data packets marked lost and not resent yet
+    i64 tcAcked;       //Data packets ack'd since the TC was last called
+    i64 tcTimeouts;    //The TC's timer has gone off this many times in a row, without anything new being ack'd
+    etcpTcEvts_t tcEvts; //What has happened since the TC was last called
+    i64 tcTimerNs;     //When the TC wants to be called with etcpTC_TIMER, <0 no timer
+    void* txTcState;   //The TC's state for this connection, NULL to use the one in etcpState_t, see etcpSetTxTcState()
+
+    //Tail loss probe. When the last packets of a burst are lost, nothing sent after them gets ack'd to show the hole. If
+    //nothing has been sent or ack'd for a probe timeout (2x SRTT), the newest unacked packet is offered to the TC to resend,
+    //which gets a sack back that either acks it or shows up what is missing. One probe per tail, until something is ack'd.
+    i64 tlpArmNs;  //When the probe timer was last (re)started. Each data transmission and each ack restarts it
+    bool tlpSent;  //A probe has gone out and nothing has been ack'd since
+
+    //Every connection has a small urgent lane. It is a connection in its own right (own sequence space, queues and acks),
+    //but it shares the flow and is always serviced ahead of the bulk data, so urgent messages never wait behind a stuck bulk
+    //packet. On the lane itself, urgent is NULL and isUrgent is set.
+    etcpConn_t* urgent;
+    bool isUrgent;
+
+    etcpStream_t* streams[ETCP_MAX_STREAMS]; //Stream 0 comes with the connection, the rest see etcpConnStreamOpen()
+
+    //Forward error correction, see etcpConnFec(). The tx side collects parity over the group being sent. The rx side collects
+    //over the last few groups, since parity for a group arrives after all of its data (or the lack of it).
+    i64 fecLog2; //Group size (log2) 0 = off
+    pgGroup_t* fecTx;
+    pgGroup_t* fecRx[ETCP_FEC_RX_GROUPS];
+    i8* fecFrame; //Scratch space for making parity packets and rebuilding data packets
+    i64 fecFrameSize;
+
+    i64 txPort;  //The port that packets on this connection are sent on
+    i64 dupPort; //If >= 0, every data packet is also sent on this port, so that the loss of one copy costs nothing
+    i64 rxDups;  //Number of duplicate data packets received and thrown away
+
+    etcpPath_t paths[ETCP_MAX_PATHS]; //Data packets are striped over these paths, instead of going on txPort
+    i64 pathCount;                    //0 = not striping
+
     //XXX HACKS BELOW!
     i64 vlan; //XXX HACK - this should be in some nice ethernet place, not here.
     i64 priority; //XXX HACK - this should be in some nice ethernet place, not here
@@ -50,4 +148,15 @@ struct etcpConn_s {
 etcpConn_t* etcpConnNew(etcpState_t* const state, const i64 windowSize, const i32 buffSize, const uint32_t srcAddr, const uint32_t srcPort, const uint64_t dstAddr, const uint32_t dstPort, const i64 vlan, const i64 priority);
 void etcpConnDelete(etcpConn_t* const conn );
 
+//Get the stream with the given id. Returns NULL if the id is out of range or if the stream has not been opened.
+etcpStream_t* etcpConnStream(const etcpConn_t* const conn, const i64 streamId);
+
+//Open the stream with the given id, if it isn't already. Streams are only ever opened by the local end, never because of
+//what turns up from the network. Returns NULL if the id is out of range or if there is no memory left.
+etcpStream_t* etcpConnStreamOpen(etcpConn_t* const conn, const i64 streamId);
+
+//Turn forward error correction on with groups of 2^fecLog2 packets (1 to PG_MAX_GROUP_LOG2), or off with fecLog2 = 0. Any
+//parity collected so far is thrown away.
+etcpError_t etcpConnFec(etcpConn_t* const conn, const i64 fecLog2);
+
 #endif /* SRC_ETCPCONN_H_ */
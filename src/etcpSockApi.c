@@ -19,6 +19,7 @@
 #include "debug.h"
 #include "utils.h"
 #include "etcpState.h"
+#include "etcpTcStatic.h"
 
 
 
@@ -331,37 +332,36 @@ etcpError_t etcpAccept(etcpSocket_t* const listenSock, etcpSocket_t** const acce
 }
 
 
-//Send on an etcpSocket
-etcpError_t etcpSend(etcpSocket_t* const sock, const void* const toSendData, i64* const toSendLen_io)
+//Run the TX transmission control and send whatever it allows for one lane of a send/recv connection pair
+static inline void etcpNetTxLane(etcpState_t* const state, etcpConn_t* const sendConn, etcpConn_t* const recvConn)
 {
-    if_unlikely(sock->type != ETCPSOCK_SR){
-        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
-        return etcpEWRONGSOCK;
-    }
-
-    if(toSendData != NULL && *toSendLen_io > 0){
-        //DBG("Triggering user TX with packet of legth %li\n", *toSendLen_io);
-        doEtcpUserTx(sock->sr.sendConn,toSendData,toSendLen_io);
-    }
-
     bool ackFirst = true;
     i64 maxAck = -1;
     i64 maxDat = -1;
 
-    cq_t* sendTxQ = sock->sr.sendConn ? sock->sr.sendConn->txQ : NULL; //Outbound DAT queue
-    cq_t* sendRxQ = sock->sr.sendConn ? sock->sr.sendConn->rxQ : NULL; //Inbound ACK queue
-    cq_t* recvTxQ = sock->sr.recvConn ? sock->sr.recvConn->txQ : NULL; //Outbound ACK queue
-    cq_t* recvRxQ = sock->sr.recvConn ? sock->sr.recvConn->rxQ : NULL; //Inboud DAT queue
+    cq_t* sendTxQ = sendConn ? sendConn->txQ : NULL; //Outbound DAT queue
+    cq_t* sendRxQ = sendConn ? sendConn->rxQ : NULL; //Inbound ACK queue
+    cq_t* recvTxQ = recvConn ? recvConn->txQ : NULL; //Outbound ACK queue
+    cq_t* recvRxQ = recvConn ? recvConn->rxQ : NULL; //Inboud DAT queue
+
+    if_eqlikely(sendConn){
+        doEtcpTailProbe(sendConn);
+    }
 
     //If TX is event triggered then do it now, this is the event!
     //DBG("Running TX traffic control\n");
-    if(sock->etcpState->eventTriggeredTx){
-        sock->etcpState->etcpTxTc(
-                sock->etcpState->etcpTxTcState,
+    if(state->eventTriggeredTx && etcpTxTcIsEvt(state)){
+        doEtcpTxEvtTc(state, sendConn, recvConn, &ackFirst, &maxAck, &maxDat);
+    }
+    else if(state->eventTriggeredTx){
+        etcpTxTcCall(
+                state,
                 sendTxQ,
                 sendRxQ,
                 recvTxQ,
                 recvRxQ,
+                sendConn ? &sendConn->rtt : NULL,
+                sendConn ? &sendConn->lat : NULL,
                 &ackFirst,
                 &maxAck,
                 &maxDat);
@@ -373,82 +373,342 @@ etcpError_t etcpSend(etcpSocket_t* const sock, const void* const toSendData, i64
     DBG("Running %li acks and %li dats, with ackfirst=%li\n",maxAck, maxDat,ackFirst ? 1 : 0);
     if(maxAck > 0 || maxDat > 0){
         if_eqlikely(ackFirst){
-            if_eqlikely(sock->sr.recvConn){
-                doEtcpNetTx(sock->sr.recvConn->txQ,sock->etcpState,maxAck);
+            if_eqlikely(recvConn){
+                doEtcpNetTx(recvConn,state,maxAck);
             }
-            if_eqlikely(sock->sr.sendConn){
-                doEtcpNetTx(sock->sr.sendConn->txQ,sock->etcpState,maxDat);
+            if_eqlikely(sendConn){
+                doEtcpNetTx(sendConn,state,maxDat);
             }
         }
         else{
-            if_eqlikely(sock->sr.sendConn){
-                doEtcpNetTx(sock->sr.sendConn->txQ,sock->etcpState,maxDat);
+            if_eqlikely(sendConn){
+                doEtcpNetTx(sendConn,state,maxDat);
             }
-            if_eqlikely(sock->sr.recvConn){
-                doEtcpNetTx(sock->sr.recvConn->txQ,sock->etcpState,maxAck);
+            if_eqlikely(recvConn){
+                doEtcpNetTx(recvConn,state,maxAck);
             }
         }
     }
+}
+
+
+static inline etcpError_t etcpSendLane(etcpSocket_t* const sock, const bool urgent, const i64 streamId, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    etcpConn_t* const sendConn = sock->sr.sendConn;
+    etcpConn_t* const recvConn = sock->sr.recvConn;
+
+    etcpStateTick(sock->etcpState); //For the user's data, the probes and the whole TX pass
+
+    if(toSendData != NULL && *toSendLen_io > 0){
+        //DBG("Triggering user TX with packet of legth %li\n", *toSendLen_io);
+        doEtcpUserTx(urgent ? sendConn->urgent : sendConn,streamId,toSendData,toSendLen_io,deadlineNs);
+    }
 
+    //The urgent lane always goes to the wire ahead of the bulk data
+    etcpNetTxLane(sock->etcpState, sendConn ? sendConn->urgent : NULL, recvConn ? recvConn->urgent : NULL);
+    etcpNetTxLane(sock->etcpState, sendConn, recvConn);
 
     return etcpENOERR;
 }
 
 
-//Recv on an etcpSocket
-etcpError_t etcpRecv(etcpSocket_t* const sock, void* const data, i64* const len_io)
+//Send on an etcpSocket
+etcpError_t etcpSend(etcpSocket_t* const sock, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs)
+{
+    return etcpSendLane(sock,false,0,toSendData,toSendLen_io,deadlineNs);
+}
+
+
+//Send on a stream of an etcpSocket
+etcpError_t etcpSendStream(etcpSocket_t* const sock, const i64 streamId, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs)
+{
+    //Don't take the user's data for a stream that isn't there
+    if_unlikely(sock->type == ETCPSOCK_SR && sock->sr.sendConn != NULL && etcpConnStream(sock->sr.sendConn,streamId) == NULL){
+        return etcpERANGE;
+    }
+    return etcpSendLane(sock,false,streamId,toSendData,toSendLen_io,deadlineNs);
+}
+
+
+//Send on the urgent lane of an etcpSocket
+etcpError_t etcpSendUrgent(etcpSocket_t* const sock, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs)
+{
+    return etcpSendLane(sock,true,0,toSendData,toSendLen_io,deadlineNs);
+}
+
+
+//Run the RX transmission control and generate whatever acks it allows for one lane of a recv connection
+static inline void etcpGenAcksLane(etcpState_t* const state, etcpConn_t* const recvConn)
+{
+    i64 maxAckPkts      = 0;
+    i64 maxAckSlots     = 0;
+    i64 maxStaleSlots   = 0;
+    i64 maxStaleAckPkts = 0;
+    if_likely(!etcpRxTcIsSet(state)){
+        doEtcpAckPolicy(recvConn, &state->ackPolicy, &maxAckSlots, &maxAckPkts, &maxStaleSlots, &maxStaleAckPkts);
+    }
+    else{
+        etcpRxTcCall(state, recvConn->rxQ, recvConn->staleQ, recvConn->txQ, &maxAckSlots, &maxAckPkts, &maxStaleSlots, &maxStaleAckPkts);
+    }
+
+    maxAckPkts = maxAckPkts < 0 ? recvConn->rxQ->__slotCount : maxAckPkts; //1 packet per slot is the maximum
+    maxAckSlots = maxAckSlots < 0 ? recvConn->rxQ->__slotCount : maxAckSlots;
+    maxStaleAckPkts = maxStaleAckPkts < 0 ? recvConn->staleQ->slotCount : maxStaleAckPkts;
+    maxStaleSlots = maxStaleSlots < 0 ? recvConn->staleQ->slotCount : maxStaleSlots;
+
+    if_eqlikely(maxAckPkts > 0 && maxAckSlots > 0){
+        generateAcks(recvConn,maxAckPkts, maxAckSlots);
+    }
+
+    if_eqlikely(maxStaleAckPkts > 0 && maxStaleSlots > 0){
+        generateStaleAcks(recvConn,maxStaleAckPkts, maxStaleSlots);
+    }
+}
+
+
+static inline etcpError_t etcpRecvLane(etcpSocket_t* const sock, const bool urgent, const i64 streamId, void* const data, i64* const len_io)
 {
     if_unlikely(sock->type != ETCPSOCK_SR){
         WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
         return etcpEWRONGSOCK;
     }
 
-    //If RX is event triggered then do it now, this is the event!
-    if(sock->sr.recvConn->rxQ->available == 0){ //There's no more RX slot, don't even bother
-        WARN("No RX slots available, not trying to RX\n");
-        return etcpETRYAGAIN;
-    }
+    etcpConn_t* const recvConn = sock->sr.recvConn;
+    etcpConn_t* const laneConn = urgent ? recvConn->urgent : recvConn;
 
+    //If RX is event triggered then do it now, this is the event! Unless there's no more RX slot, then don't even bother, but
+    //carry on to ack and deliver what is already here, which is what frees the slots up again.
     i64 rxPackets = 0;
-    if_eqlikely(sock->etcpState->eventTriggeredRx){
+    if_unlikely(laneConn->rxQ->available == 0){
+        WARN("No RX slots available, not trying to RX\n");
+        etcpStateTick(sock->etcpState); //For the ack delays below
+    }
+    else if_eqlikely(sock->etcpState->eventTriggeredRx){
         rxPackets = doEtcpNetRx(sock->etcpState); //It doesn't matter how much we receive here
     }
+    else{
+        etcpStateTick(sock->etcpState);
+    }
+
+    //Both lanes need acking, whichever one the user happens to be reading. Urgent acks go first. This happens on every call,
+    //even with nothing new, so that delayed acks go out when their time is up.
+    etcpGenAcksLane(sock->etcpState, recvConn->urgent);
+    etcpGenAcksLane(sock->etcpState, recvConn);
 
     if_eqlikely(data == NULL || len_io == NULL || *len_io == 0){
         //Not trying to RX anything, just triggering a HW rx in case, but check if there is something for the user
         return etcpENOERR;
     }
 
-    if(rxPackets == 0 && sock->sr.recvConn->rxQ->readable == 0){
+    if(rxPackets == 0 && recvConn->rxQ->readable == 0 && recvConn->urgent->rxQ->readable == 0){
         //We didn't get anything new, and there's nothing waiting, so there's nothing to do
         return etcpETRYAGAIN;
     }
 
+    return doEtcpUserRx(laneConn,streamId,data,len_io);
+}
 
-    i64 maxAckPkts      = 0;
-    i64 maxAckSlots     = 0;
-    i64 maxStaleSlots   = 0;
-    i64 maxStaleAckPkts = 0;
-    sock->etcpState->etcpRxTc(sock->etcpState->etcpRxTcState, sock->sr.recvConn->rxQ, sock->sr.recvConn->staleQ, sock->sr.recvConn->txQ, &maxAckSlots, &maxAckPkts, &maxStaleSlots, &maxStaleAckPkts);
 
-    maxAckPkts = maxAckPkts < 0 ? sock->sr.recvConn->rxQ->__slotCount : maxAckPkts; //1 packet per slot is the maximum
-    maxAckSlots = maxAckSlots < 0 ? sock->sr.recvConn->rxQ->__slotCount : maxAckSlots;
-    maxStaleAckPkts = maxStaleAckPkts < 0 ? sock->sr.recvConn->staleQ->slotCount : maxStaleAckPkts;
-    maxStaleSlots = maxStaleSlots < 0 ? sock->sr.recvConn->staleQ->slotCount : maxStaleSlots;
+//Recv on an etcpSocket
+etcpError_t etcpRecv(etcpSocket_t* const sock, void* const data, i64* const len_io)
+{
+    return etcpRecvLane(sock,false,0,data,len_io);
+}
+
 
-    if_eqlikely(maxAckPkts > 0 && maxAckSlots > 0){
-        generateAcks(sock->sr.recvConn,maxAckPkts, maxAckSlots);
+//Recv on a stream of an etcpSocket
+etcpError_t etcpRecvStream(etcpSocket_t* const sock, const i64 streamId, void* const data, i64* const len_io)
+{
+    if_unlikely(sock->type == ETCPSOCK_SR && sock->sr.recvConn != NULL && etcpConnStream(sock->sr.recvConn,streamId) == NULL){
+        return etcpERANGE;
     }
+    return etcpRecvLane(sock,false,streamId,data,len_io);
+}
 
-    if_eqlikely(maxStaleAckPkts > 0 && maxStaleSlots > 0){
-        generateStaleAcks(sock->sr.recvConn,maxStaleAckPkts, maxStaleSlots);
+
+//Recv on the urgent lane of an etcpSocket
+etcpError_t etcpRecvUrgent(etcpSocket_t* const sock, void* const data, i64* const len_io)
+{
+    return etcpRecvLane(sock,true,0,data,len_io);
+}
+
+
+
+//Open a stream on an etcpSocket, in both directions
+etcpError_t etcpOpenStream(etcpSocket_t* const sock, const i64 streamId)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    if_unlikely(streamId < 0 || streamId >= ETCP_MAX_STREAMS){
+        WARN("Stream id %li is out of range, max is %li\n", streamId, ETCP_MAX_STREAMS - 1);
+        return etcpERANGE;
+    }
+
+    if_eqlikely(sock->sr.sendConn != NULL && etcpConnStreamOpen(sock->sr.sendConn,streamId) == NULL){
+        return etcpENOMEM;
+    }
+    if_eqlikely(sock->sr.recvConn != NULL && etcpConnStreamOpen(sock->sr.recvConn,streamId) == NULL){
+        return etcpENOMEM;
+    }
+    return etcpENOERR;
+}
+
+
+//Turn on/off forward error correction for data sent on this socket
+etcpError_t etcpSetFec(etcpSocket_t* const sock, const i64 fecLog2)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR || sock->sr.sendConn == NULL){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    //The receiver follows along by itself, it only needs to know the group size, which is in every data packet
+    etcpError_t err = etcpConnFec(sock->sr.sendConn,fecLog2);
+    if_unlikely(err != etcpENOERR){
+        return err;
+    }
+    return etcpConnFec(sock->sr.sendConn->urgent,fecLog2);
+}
+
+
+//Turn on/off redundant transmission for data sent on this socket
+etcpError_t etcpSetRedundant(etcpSocket_t* const sock, const i64 txPort, const i64 dupPort)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR || sock->sr.sendConn == NULL){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    const i64 portCount = sock->etcpState->portCount;
+    if_unlikely(txPort < 0 || txPort >= portCount || dupPort < -1 || dupPort >= portCount || dupPort == txPort){
+        WARN("Bad ports for redundant transmission, txPort=%li, dupPort=%li, with %li ports\n", txPort, dupPort, portCount);
+        return etcpERANGE;
     }
 
+    etcpConn_t* const sendConn = sock->sr.sendConn;
+    sendConn->txPort            = txPort;
+    sendConn->dupPort           = dupPort;
+    sendConn->pathCount         = 0;
+    sendConn->urgent->txPort    = txPort;
+    sendConn->urgent->dupPort   = dupPort;
+    sendConn->urgent->pathCount = 0;
 
-    return doEtcpUserRx(sock->sr.recvConn,data,len_io);
+    return etcpENOERR;
 }
 
 
+//Set up striping for one lane
+static inline void etcpSetPaths(etcpConn_t* const conn, const i64* const ports, const i64 portCount)
+{
+    conn->txPort    = ports[0];
+    conn->dupPort   = -1;
+    conn->pathCount = portCount > 1 ? portCount : 0;
+    for(i64 i = 0; i < conn->pathCount; i++){
+        conn->paths[i].port   = ports[i];
+        conn->paths[i].pass   = 0;
+        rttReset(&conn->paths[i].rtt,ETCP_RTT_WIN_NS);
+    }
+}
+
+
+//Turn on/off multipath striping for data sent on this socket
+etcpError_t etcpSetMultipath(etcpSocket_t* const sock, const i64* const ports, const i64 portCount)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR || sock->sr.sendConn == NULL){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    if_unlikely(portCount < 0 || portCount > ETCP_MAX_PATHS || (portCount > 0 && ports == NULL)){
+        WARN("Bad port count %li for striping, max is %li\n", portCount, ETCP_MAX_PATHS);
+        return etcpERANGE;
+    }
+
+    for(i64 i = 0; i < portCount; i++){
+        if_unlikely(ports[i] < 0 || ports[i] >= sock->etcpState->portCount){
+            WARN("Bad port %li for striping, with %li ports\n", ports[i], sock->etcpState->portCount);
+            return etcpERANGE;
+        }
+    }
+
+    const i64 defaultPort = 0;
+    const i64* const lanePorts = portCount > 0 ? ports : &defaultPort;
+    etcpSetPaths(sock->sr.sendConn,lanePorts,portCount);
+    etcpSetPaths(sock->sr.sendConn->urgent,lanePorts,portCount);
+
+    return etcpENOERR;
+}
+
+
+//Give this socket its own TX TC state
+etcpError_t etcpSetTxTcState(etcpSocket_t* const sock, void* const txTcState)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    etcpConn_t* const conns[] = { sock->sr.sendConn, sock->sr.recvConn };
+    for(i64 i = 0; i < 2; i++){
+        if_eqlikely(conns[i] != NULL){
+            conns[i]->txTcState         = txTcState;
+            conns[i]->urgent->txTcState = txTcState;
+        }
+    }
+    return etcpENOERR;
+}
+
+
+i64 etcpRecvDuplicates(etcpSocket_t* const sock)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR || sock->sr.recvConn == NULL){
+        return 0;
+    }
+
+    return sock->sr.recvConn->rxDups + sock->sr.recvConn->urgent->rxDups;
+}
+
+
+i64 etcpSendLatency(etcpSocket_t* const sock, etcpLatency_t* const recs_o, const i64 maxRecs)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR || sock->sr.sendConn == NULL || recs_o == NULL){
+        return 0;
+    }
+
+    const etcpLatRing_t* const lat = &sock->sr.sendConn->lat;
+    const i64 count = MIN(MIN(maxRecs, lat->count), 1 << ETCP_LAT_RING_LOG2);
+    for(i64 i = 0; i < count; i++){
+        recs_o[i] = lat->recs[(lat->count - 1 - i) & ((1 << ETCP_LAT_RING_LOG2) - 1)];
+    }
+    return MAX(count, 0);
+}
+
+
+etcpError_t etcpPeerClock(etcpSocket_t* const sock, i64* const offsetNs_o, i64* const driftPpb_o)
+{
+    if_unlikely(sock->type != ETCPSOCK_SR || sock->sr.sendConn == NULL){
+        WARN("Wrong socket type, expected %li but got %li\n", ETCPSOCK_SR, sock->type);
+        return etcpEWRONGSOCK;
+    }
+
+    const coEst_t* const peerClock = &sock->sr.sendConn->peerClock;
+    if_unlikely(peerClock->samples == 0){
+        return etcpETRYAGAIN;
+    }
+
+    *offsetNs_o = peerClock->offsetNs;
+    *driftPpb_o = peerClock->driftPpb;
+    return etcpENOERR;
+}
+
 
 //Close down the socket and free resources
 void etcpClose(etcpSocket_t* const sock)
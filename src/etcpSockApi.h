@@ -37,12 +37,60 @@ etcpError_t etcpListen(etcpSocket_t* const sock, uint32_t backlog);
 //Dequeue new connections from the listen queue
 etcpError_t etcpAccept(etcpSocket_t* const listenSock, etcpSocket_t** const acceptSock_o);
 
-//Send on an etcpSocket
-etcpError_t etcpSend(etcpSocket_t* const sock, const void* const toSendData, i64* const toSendLen_io);
+//Send on an etcpSocket. If deadlineNs is not ETCP_NO_DEADLINE, it is the absolute time (unix time in ns) after which the
+//message is no longer useful. Expired messages are never (re)transmitted, the receiver is told to skip over them instead.
+#define ETCP_NO_DEADLINE (0)
+etcpError_t etcpSend(etcpSocket_t* const sock, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs);
 
 //Recv on an etcpSocket
 etcpError_t etcpRecv(etcpSocket_t* const sock, void* const data, i64* const len_io);
 
+//Send/Recv on the urgent lane of an etcpSocket. The urgent lane has its own (small) window and sequence space. It is sent
+//ahead of, and delivered independently of the normal data, so urgent messages are never stuck behind lost bulk packets.
+etcpError_t etcpSendUrgent(etcpSocket_t* const sock, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs);
+etcpError_t etcpRecvUrgent(etcpSocket_t* const sock, void* const data, i64* const len_io);
+
+//Send/Recv on a stream of an etcpSocket. Streams share the connection, its window and its acks, but each stream is ordered
+//independently, so a lost packet only holds up delivery on its own stream. etcpSend/etcpRecv use stream 0. Stream ids go
+//from 0 to ETCP_MAX_STREAMS - 1. Stream 0 is always open, any other stream has to be opened with etcpOpenStream() at both
+//ends before it is used. Data that turns up for a stream that isn't open is dropped (and not ack'd), so it is sent again
+//until the receiver opens the stream. Sending or receiving on a stream that isn't open is etcpERANGE.
+etcpError_t etcpSendStream(etcpSocket_t* const sock, const i64 streamId, const void* const toSendData, i64* const toSendLen_io, const i64 deadlineNs);
+etcpError_t etcpRecvStream(etcpSocket_t* const sock, const i64 streamId, void* const data, i64* const len_io);
+etcpError_t etcpOpenStream(etcpSocket_t* const sock, const i64 streamId);
+
+//Turn on forward error correction for data sent on this socket. After every group of 2^fecLog2 data packets (1 <= fecLog2 <=
+//PG_MAX_GROUP_LOG2), a parity packet is sent, from which the receiver can rebuild any one lost packet of the group without
+//waiting for a retransmit. Costs one extra packet per group on the wire. fecLog2 = 0 turns it off again.
+etcpError_t etcpSetFec(etcpSocket_t* const sock, const i64 fecLog2);
+
+//Send every data packet on this socket twice, once on txPort and again on dupPort (ports as numbered by the state, see
+//etcpStateAddPort()), so that loss or queueing on one path costs nothing. The receiver keeps the first copy to arrive.
+//dupPort = -1 turns it off again.
+etcpError_t etcpSetRedundant(etcpSocket_t* const sock, const i64 txPort, const i64 dupPort);
+
+//Stripe data packets sent on this socket over several ports (as numbered by the state, see etcpStateAddPort()), in
+//proportion to 1/RTT of each. Useful to go faster than one port. The receiver puts things back in order. Acks and parity
+//go on the first port. A portCount of 0 or 1 turns striping off again. Striping and redundant transmission are exclusive,
+//turning one on turns the other off.
+etcpError_t etcpSetMultipath(etcpSocket_t* const sock, const i64* const ports, const i64 portCount);
+
+//Give this socket its own state for the event driven TX TC (see etcpStateSetTxEvtTc()), instead of the one that the whole
+//stack shares. A TC that keeps per flow state (eg etcpTcDelay_t, etcpTcBbr_t) needs one for each connection. Both lanes and
+//both directions of the socket use it. NULL goes back to the shared state.
+etcpError_t etcpSetTxTcState(etcpSocket_t* const sock, void* const txTcState);
+
+//Number of duplicate data packets that have been received on this socket and thrown away
+i64 etcpRecvDuplicates(etcpSocket_t* const sock);
+
+//Copy out up to maxRecs of the latest latency records for data sent on this socket (see etcpLatency_t), newest first.
+//Returns the number copied.
+i64 etcpSendLatency(etcpSocket_t* const sock, etcpLatency_t* const recs_o, const i64 maxRecs);
+
+//The remote end's clock against ours, as worked out from the data sent on this socket. offsetNs_o is remote - local, and
+//driftPpb_o is how fast the remote clock gains on ours (parts per billion). Returns etcpETRYAGAIN until there is an estimate.
+etcpError_t etcpPeerClock(etcpSocket_t* const sock, i64* const offsetNs_o, i64* const driftPpb_o);
+
 //Close down the socket and free resources
 void etcpClose(etcpSocket_t* const sock);
 
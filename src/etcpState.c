@@ -10,6 +10,7 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "etcpState.h"
 #include "etcpConn.h"
@@ -102,9 +103,10 @@ etcpState_t* etcpStateNew(
         return NULL;
     }
 
-    etcpState->ethHwRx          = ethHwRx;
-    etcpState->ethHwTx          = ethHwTx;
-    etcpState->ethHwState       = ethHwState;
+    etcpState->ports[0].ethHwRx    = ethHwRx;
+    etcpState->ports[0].ethHwTx    = ethHwTx;
+    etcpState->ports[0].ethHwState = ethHwState;
+    etcpState->portCount           = 1;
     etcpState->etcpTxTc         = etcpTxTc;
     etcpState->etcpTxTcState    = etcpTxTcState;
     etcpState->eventTriggeredTx = eventTriggeredTx;
@@ -112,6 +114,13 @@ etcpState_t* etcpStateNew(
     etcpState->etcpRxTcState    = etcpRxTcState;
     etcpState->eventTriggeredRx = eventTriggeredRx;
 
+    etcpState->ackPolicy.everyPkts  = ETCP_ACK_EVERY_DEFAULT;
+    etcpState->ackPolicy.maxDelayNs = ETCP_ACK_DELAY_DEFAULT_NS;
+    etcpState->ackPolicy.rxFullPct  = ETCP_ACK_RXFULL_DEFAULT;
+
+    clkInit(&etcpState->clock,clkREALTIME,NULL,NULL);
+    etcpState->nowNs = clkNowNs(&etcpState->clock);
+
 
     etcpState->dstMap = htNew(DST_TAB_MAX_LOG2);
     if_unlikely(!etcpState->dstMap){
@@ -121,3 +130,72 @@ etcpState_t* etcpStateNew(
 
     return etcpState;
 }
+
+
+etcpError_t etcpStateAddPort(etcpState_t* const state, void* const ethHwState, const ethHwTx_f ethHwTx, const ethHwRx_f ethHwRx, i64* const portIdx_o)
+{
+    if_unlikely(state->portCount >= ETCP_MAX_PORTS){
+        WARN("Too many ports, max is %li\n", ETCP_MAX_PORTS);
+        return etcpETOOMANY;
+    }
+
+    etcpPort_t* const port = &state->ports[state->portCount];
+    port->ethHwState = ethHwState;
+    port->ethHwTx    = ethHwTx;
+    port->ethHwRx    = ethHwRx;
+
+    *portIdx_o = state->portCount;
+    state->portCount++;
+    return etcpENOERR;
+}
+
+
+etcpError_t etcpStateSetTxTs(etcpState_t* const state, const i64 portIdx, const ethHwTxTs_f ethHwTxTs)
+{
+    if_unlikely(portIdx < 0 || portIdx >= state->portCount){
+        WARN("No port %li, there are %li\n", portIdx, state->portCount);
+        return etcpERANGE;
+    }
+
+    etcpPort_t* const port = &state->ports[portIdx];
+    port->ethHwTxTs = ethHwTxTs;
+    port->txCount   = 0; //The hardware will count from 0 too
+    memset(port->txPending,0,sizeof(port->txPending));
+    return etcpENOERR;
+}
+
+
+etcpError_t etcpStateSetHwClock(etcpState_t* const state, const i64 portIdx, const ethHwClk_f ethHwClk)
+{
+    if_unlikely(portIdx < 0 || portIdx >= state->portCount){
+        WARN("No port %li, there are %li\n", portIdx, state->portCount);
+        return etcpERANGE;
+    }
+
+    etcpPort_t* const port = &state->ports[portIdx];
+    port->ethHwClk = ethHwClk;
+    port->rxPolls  = 0; //Take a pair on the next poll
+    cmReset(&port->hwClock,ETCP_HWCLK_PERIOD_NS);
+    return etcpENOERR;
+}
+
+
+clkSrc_t etcpStateSetClock(etcpState_t* const state, const clkSrc_t src, const clkNow_f nowFn, void* const nowState)
+{
+    const clkSrc_t result = clkInit(&state->clock,src,nowFn,nowState);
+    state->nowNs = clkNowNs(&state->clock);
+    return result;
+}
+
+
+void etcpStateSetTxEvtTc(etcpState_t* const state, const etcpTxEvtTc_f etcpTxEvtTc, void* const etcpTxTcState)
+{
+    state->etcpTxEvtTc   = etcpTxEvtTc;
+    state->etcpTxTcState = etcpTxTcState;
+}
+
+
+void etcpStateSetAckPolicy(etcpState_t* const state, const etcpAckPolicy_t* const policy)
+{
+    state->ackPolicy = *policy;
+}
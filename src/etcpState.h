@@ -16,6 +16,9 @@
 #include "HashTable.h"
 #include "CircularQueue.h"
 #include "LinkedList.h"
+#include "RttEstimator.h"
+#include "ClockModel.h"
+#include "Clock.h"
 
 
 #define DST_TAB_MAX_LOG2 (17) //2^17 = 128K dst Adrr/Port pairs, 1MB in memory
@@ -44,7 +47,136 @@ typedef struct etcpConn_s etcpConn_t;
 //    maxAckPkts =0, no packets will be generated,  >0 at most maxAckPkts will be generated. The default value is 0.
 typedef void (*etcpRxTc_f)(void* const rxTcState, const cq_t* const datRxQ, const ll_t* datStaleQ, const cq_t* const ackTxQ, i64* const maxAckSlots_o, i64* const maxAckPkts_o,  i64* const maxStaleSlots_o,  i64* const maxStaleAckPkts_o  );
 
-typedef void (*etcpTxTc_f)(void* const txTcState, const cq_t* const datTxQ, const cq_t* ackRxQ, cq_t* ackTxQ, const cq_t* const datRxQ,  bool* const ackFirst, i64* const maxAck_o, i64* const maxDat_o);
+// Built-in ack coalescing:
+// If no RX TC is given to etcpStateNew() (etcpRxTc == NULL), this policy decides when to ack instead. Everything waiting is
+// ack'd as soon as any one of these says so, or a packet arrives with ackNow set (the sender is retransmitting or probing,
+// and is waiting on the ack). Stale packets are always ack'd straight away, they mean that an ack has been lost.
+typedef struct {
+    i64 everyPkts;  //Ack once this many packets are waiting. <=1 acks every packet
+    i64 maxDelayNs; //Ack once the oldest waiting packet has waited this long. <0 no time limit
+    i64 rxFullPct;  //Ack once this much (%) of the rx window is in use, so that the sender doesn't stall on it. <0 never
+} etcpAckPolicy_t;
+
+#define ETCP_ACK_EVERY_DEFAULT    (16)
+#define ETCP_ACK_DELAY_DEFAULT_NS (5 * 1000) //Keep this under ETCP_TLP_MIN_NS, or the sender will probe for delayed acks
+#define ETCP_ACK_RXFULL_DEFAULT   (50)
+
+// Latency breakdown:
+// Every etcpTime_t carries four timestamps, two from each end, so an ack says where the time went on the way there and back.
+// Each ack gives one record, from the newest data packet that it acks (if that packet was only sent once). Hosts and NICs
+// only compare their own clocks, so no clock sync is needed, except between each host and its own NIC (see packets.h). A
+// part that can't be measured (no hardware timestamp, or one that doesn't make sense against the software clock) is -1, and
+// its time is counted in networkNs instead.
+typedef struct {
+    i64 timeNs;      //When the ack arrived (local software time)
+    i64 rttNs;       //Local software TX of the data to local software RX of the ack
+    i64 localTxNs;   //Local host to NIC, for the data
+    i64 localRxNs;   //Local NIC to host, for the ack
+    i64 remoteRxNs;  //Remote NIC to host, for the data
+    i64 remoteAckNs; //Remote host, from receiving the data to sending the ack. Includes the time spent coalescing acks
+    i64 networkNs;   //Everything else, the fabric there and back plus the remote host to NIC for the ack
+
+    //One way delays, host to host, using the estimated offset of the remote clock (see ClockOffset.h). Queueing in one
+    //direction only shows up in that direction, but the base delay is always split evenly between the two.
+    i64 fwdNs;       //Local software TX of the data to remote software RX
+    i64 revNs;       //Remote software TX of the ack to local software RX
+} etcpLatency_t;
+
+#define ETCP_LAT_RING_LOG2 (4) //Latency records kept on each connection
+
+//The latest latency records on a connection, the oldest is overwritten first. There is no reader pointer, readers take what
+//they want from the newest backwards.
+typedef struct {
+    etcpLatency_t recs[1 << ETCP_LAT_RING_LOG2];
+    i64 count; //Records written so far, the newest is recs[(count - 1) & mask]
+} etcpLatRing_t;
+
+// Transmit Transmission Control callback:
+// This function is supplied by the user. It decides which packets in the TX queues go now, by setting their txState to
+// ETCP_TX_NOW (or ETCP_TX_DRP), and how many slots doEtcpNetTx() will look at. Data packets that the stack presumes lost
+// (because packets sent after them have been ack'd, see ETCP_REORDER_THRESH) have pBuff_t.lost set. These should usually
+// be resent straight away rather than waiting for a retransmit timeout. The newest unacked data packet has pBuff_t.probe set
+// when nothing has been sent or ack'd on the connection for a while (see tlpArmNs), this should also be resent straight away.
+// Data packets beyond the end of the receiver's window (see txEdge) are held back until an ack opens it up, whatever the TC says.
+// The connection's RTT estimates (smoothed, variation, windowed min and max) are passed in as datRtt. Only packets that were
+// sent once are measured. datRtt is NULL along with datTxQ, and datRtt->samples is 0 until the first packet is ack'd. The
+// breakdown of the latest round trips (see etcpLatency_t) is in datLat, also NULL along with datTxQ.
+typedef void (*etcpTxTc_f)(void* const txTcState, const cq_t* const datTxQ, const cq_t* ackRxQ, cq_t* ackTxQ, const cq_t* const datRxQ, const rttEst_t* const datRtt, const etcpLatRing_t* const datLat, bool* const ackFirst, i64* const maxAck_o, i64* const maxDat_o);
+
+// Event driven Transmit Transmission Control callback:
+// An alternative to the TX TC above, set with etcpStateSetTxEvtTc(). The TX TC is given the queues, so it has to scan them
+// on every call to find out what has changed. This one is told instead. The stack records what happens on each send
+// connection between calls (etcpTcEvt_t) and keeps a summary of where it is now (etcpTcSummary_t), so the TC's work is
+// proportional to what has changed rather than to the size of the window. The TC doesn't set txState either, it answers with
+// an etcpTcAction_t and the stack works out what goes:
+//  - Acks, new data packets, lost packets and probes (see above) are always ready to go, as far as maxAck and maxDat allow
+//  - Anything else that is waiting for an ack is only resent when the TC asks for it, with resendFrom and resendCount
+// There are no events or data fields in the summary for a lane with no send connection (rtt is NULL).
+// This is for TX only. The RX TC (see etcpRxTc_f) is still given the queues, it only has to decide when acks go out.
+typedef enum {
+    etcpTC_QUEUED = 0, //The user queued data packets seq ... seq + count - 1
+    etcpTC_ACKED,      //Data packets seq ... seq + count - 1 were ack'd, the ack arrived at valNs
+    etcpTC_LOST,       //Data packet seq is presumed lost (count 1), it will be resent
+    etcpTC_PROBE,      //Data packet seq is the tail loss probe (count 1), it will be resent
+    etcpTC_RTT,        //The latest RTT sample, of valNs from data packet seq. count is the samples since the last call
+    etcpTC_TIMER,      //The TC's timer (see etcpTcAction_t.timerNs) has gone off, the time is valNs
+} etcpTcEvtType_t;
+
+typedef struct {
+    etcpTcEvtType_t type;
+    i64 seq;
+    i64 count;
+    i64 valNs;
+} etcpTcEvt_t;
+
+#define ETCP_TC_EVTS_MAX (64) //Events kept on each connection between TC calls. Runs of queued and ack'd packets take one
+
+//The events since the last call, in the order they happened, except that a run of queued or ack'd packets is folded into the
+//latest event of the same type (if it carries on from it) even when other events came in between, and RTT samples are all
+//folded into one event. So a window's worth of acks takes a couple of events rather than one per packet. If there are more
+//than fit, the rest are counted in dropped, the summary (including the ack'd count) is still right. The last slot is kept
+//for the timer, so that it is never dropped.
+typedef struct {
+    etcpTcEvt_t evts[ETCP_TC_EVTS_MAX];
+    i64 count;
+    i64 dropped;
+
+    //__itmes are "private"
+    i64 __latest[etcpTC_TIMER + 1]; //1 + the index of the latest event of each type, 0 for none
+} etcpTcEvts_t;
+
+typedef struct {
+    i64 nowNs;        //The stack's time for this TX pass, see etcpState_t.nowNs
+    i64 seqUnacked;   //The oldest data packet that hasn't been ack'd yet, everything before it has
+    i64 seqSent;      //One past the newest data packet that has been sent
+    i64 seqQueued;    //One past the newest data packet that the user has queued
+    i64 txEdge;       //The end of the receiver's window. Nothing at or past it is sent, whatever the TC says
+    i64 outstanding;  //Data packets sent and not ack'd yet, including the lost ones
+    i64 acked;        //Data packets ack'd since the last call
+    i64 timeouts;     //The TC's timer has gone off this many times in a row on this lane, without anything new being ack'd,
+                      //including this call. For a TC that only uses the timer as a retransmit timeout, this is its backoff
+    i64 lost;         //Data packets presumed lost and not resent yet
+    i64 acksWaiting;  //Acks queued on the reverse connection
+    i64 evtsDropped;  //Events since the last call that didn't fit, see etcpTcEvts_t
+    bool urgent;      //This is a connection's urgent lane (see etcpConn_t.urgent). The TC is called for each lane with the
+                      //same state, so a TC that keeps per flow state (a window, pacing) should usually leave this one alone.
+                      //Such a TC also needs a state for each connection, see etcpSetTxTcState()
+    const rttEst_t* rtt;      //As datRtt for the TX TC
+    const etcpLatRing_t* lat; //As datLat for the TX TC
+} etcpTcSummary_t;
+
+//What the TC wants done. The stack fills in the defaults before the call, so the TC only needs to change what it cares about.
+typedef struct {
+    bool ackFirst;    //Send the acks before the data. Defaults to true
+    i64 maxAck;       //Acks to send, <0 all of them. Defaults to -1
+    i64 maxDat;       //Slots from seqUnacked on that may be sent (a congestion window), <0 no limit. Defaults to -1
+    i64 resendFrom;   //Resend the data packets from here...
+    i64 resendCount;  //...to resendFrom + resendCount - 1 that are still waiting for an ack, eg on a timeout. Defaults to 0
+    i64 timerNs;      //Call again with an etcpTC_TIMER event once the stack's time reaches this, <0 no timer. Defaults to
+                      //the timer that is already set, it is cleared when it goes off
+} etcpTcAction_t;
+
+typedef void (*etcpTxEvtTc_f)(void* const txTcState, const etcpTcSummary_t* const sum, const etcpTcEvt_t* const evts, const i64 evtCount, etcpTcAction_t* const act_io);
 
 
 //The ETCP internal state expects to be provided with hardware send and receive operations, these typedefs spell them out
@@ -53,26 +185,72 @@ typedef void (*etcpTxTc_f)(void* const txTcState, const cq_t* const datTxQ, cons
 typedef int64_t (*ethHwTx_f)(void* const hwState, const void* const data, const int64_t len, uint64_t* const hwTxTimeNs );
 //Returns: >0, number of bytes received, =0, nothing available right now, <0 hw specific error code
 typedef int64_t (*ethHwRx_f)(void* const hwState, void* const data, const int64_t len, uint64_t* const hwRxTimeNs );
-
+//Optional. For hardware that can't (or shouldn't have to wait to) give the TX timestamp back from ethHwTx(). Completed TX
+//timestamps are collected from here instead, whenever the ports are polled for RX. txId counts the frames that ethHwTx()
+//has sent on this hwState, starting at 0. Completions can come back in any order, and not every frame needs one.
+//Returns: >0, a completion was returned, =0, nothing has completed right now, <0 hw specific error code
+typedef int64_t (*ethHwTxTs_f)(void* const hwState, int64_t* const txId_o, uint64_t* const hwTxTimeNs_o );
+//Optional. Read the hardware clock (in the same units as the hardware timestamps) and the software clock (CLOCK_REALTIME ns)
+//at the same moment, with how far out the pairing could be (eg how long the hardware read took). With this, hardware times
+//are converted into software time as they come in, so that they can be compared with the software times. The pairs are
+//only taken every so often (see ETCP_HWCLK_POLLS), so it doesn't need to be cheap.
+//Returns: >0, a pair was returned, =0, can't read the clocks right now, <0 hw specific error code
+typedef int64_t (*ethHwClk_f)(void* const hwState, uint64_t* const hwTimeNs_o, int64_t* const swTimeNs_o, int64_t* const errNs_o );
+
+
+
+#define ETCP_MAX_PORTS (4) //Enough for a 4 port NIC
+#define ETCP_TX_PENDING_LOG2 (8) //Frames that can be waiting for their TX timestamp on each port
+#define ETCP_HWCLK_POLLS (1024) //Ports with an ethHwClk have their clocks paired once per this many RX polls. Must be a power of 2
+#define ETCP_HWCLK_PERIOD_NS (100LL * 1000 * 1000) //How often the hardware clock model takes a new anchor, see ClockModel.h
+
+//A frame that has gone out on a port with ethHwTxTs, waiting for its TX timestamp to complete
+typedef struct {
+    i64 txId;         //Which frame on the port this is. If it doesn't match, the entry has been reused and the timestamp is too late
+    etcpConn_t* conn; //Where the timestamp goes, NULL if no one wants it
+    i64 seq;
+    i64 txOrder;      //Which transmission of the packet this was, see pBuff_t.txOrder
+} etcpTxPending_t;
+
+//A port is one independent path to the network, usually one NIC port.
+typedef struct {
+    void* ethHwState;      //Pointer to HW state structures
+    ethHwTx_f ethHwTx;     //Callback for abstracting ethernet hardware TX
+    ethHwRx_f ethHwRx;     //Callback for abstracting ethernet hardware RX
+    ethHwTxTs_f ethHwTxTs; //Callback for collecting TX timestamps later, NULL if ethHwTx() gives them back itself
+
+    i64 txCount; //Frames sent on this port so far, the next txId. Only counted when there is an ethHwTxTs
+    etcpTxPending_t txPending[1 << ETCP_TX_PENDING_LOG2]; //Indexed by txId
+
+    ethHwClk_f ethHwClk; //Callback for pairing the hardware and software clocks, NULL if hardware times are used as they are
+    cmModel_t hwClock;   //Hardware to software time for this port's timestamps, only used with an ethHwClk
+    i64 rxPolls;         //Number of times the port has been polled for RX, for pacing the clock pairing
+} etcpPort_t;
 
 
 typedef struct etcpState_s {
 
-    void* ethHwState;  //Pointer to HW state structures
-    ethHwTx_f ethHwTx; //Callback for abstracting ethernet hardware TX
-    ethHwRx_f ethHwRx; //Callback for abstracting ethernet hardware RX
+    etcpPort_t ports[ETCP_MAX_PORTS]; //Port 0 is given to etcpStateNew(), the rest are added with etcpStateAddPort()
+    i64 portCount;
 
     void* etcpRxTcState; //Pointer for user supplied Tranmission Control TX state
     etcpRxTc_f etcpRxTc; //Callback for implementing congestion control on the RX side (generating acks).
+    etcpAckPolicy_t ackPolicy; //Used instead of etcpRxTc when it is NULL
 
     void* etcpTxTcState; //Pointer for user supplied Tranmission Control TX state
     etcpTxTc_f etcpTxTc; //Callback for implementing congestion control on the TX side (sending frames).
+    etcpTxEvtTc_f etcpTxEvtTc; //Used instead of etcpTxTc when it is set, see etcpStateSetTxEvtTc()
 
     //If you are using event triggered TX, you need to ensure that "send" is called regulalrly to trigger retransmit timeouts
     //ideally this should be called at least 2x as fast as your RTO so that RTOs are sent in a timely maner.
     bool eventTriggeredRx; //Should RX be triggered by a recv socket event, or should there be a thread spinning.
     bool eventTriggeredTx; //Should TX be triggered by a send socket event, or should there be a thread spinning.
 
+    //The software time is read once at the start of each RX poll, TX pass or user send, and that time is used for
+    //everything in it (timestamps, ack delays, deadlines, probes). A burst of packets all get the same time.
+    clk_t clock;
+    i64 nowNs;
+
     ht_t* dstMap; //All unique dst address/port combinations
 } etcpState_t;
 
@@ -113,6 +291,29 @@ etcpState_t* etcpStateNew(
     void* const etcpRxTcState,
     const bool eventTriggeredRx
 );
+//Add another port. All ports are polled for RX, connections choose which ones they TX on.
+etcpError_t etcpStateAddPort(etcpState_t* const state, void* const ethHwState, const ethHwTx_f ethHwTx, const ethHwRx_f ethHwRx, i64* const portIdx_o);
+//Collect TX timestamps for a port with ethHwTxTs, rather than from ethHwTx(). NULL goes back to ethHwTx(). This needs to be
+//done before anything is sent on the port, so that the frame counts on both sides agree.
+etcpError_t etcpStateSetTxTs(etcpState_t* const state, const i64 portIdx, const ethHwTxTs_f ethHwTxTs);
+//Convert the hardware timestamps on a port into software time, using pairs of clock readings from ethHwClk. NULL goes back
+//to using the hardware times as they are.
+etcpError_t etcpStateSetHwClock(etcpState_t* const state, const i64 portIdx, const ethHwClk_f ethHwClk);
+//Read the clock for the start of an RX poll, TX pass or user send. Everything in it uses state->nowNs from then on.
+static inline i64 etcpStateTick(etcpState_t* const state)
+{
+    state->nowNs = clkNowNs(&state->clock);
+    return state->nowNs;
+}
+//Change where the software time comes from, see Clock.h. The TSC is calibrated here, which takes a few ms. Returns the
+//source actually used, the system clock if the one asked for isn't available.
+clkSrc_t etcpStateSetClock(etcpState_t* const state, const clkSrc_t src, const clkNow_f nowFn, void* const nowState);
+//Use an event driven TX TC (see etcpTxEvtTc_f) instead of the one given to etcpStateNew(). The TC state is replaced too. NULL
+//goes back to the TX TC, with state NULL. Events are only recorded while there is an event driven TC, so this should be done
+//before anything is sent.
+void etcpStateSetTxEvtTc(etcpState_t* const state, const etcpTxEvtTc_f etcpTxEvtTc, void* const etcpTxTcState);
+//Change the built-in ack coalescing policy, see etcpAckPolicy_t. Only used if there is no RX TC.
+void etcpStateSetAckPolicy(etcpState_t* const state, const etcpAckPolicy_t* const policy);
 etcpLAMap_t* srcsMapNew( const uint32_t listenWindowSize, const uint32_t listenBuffSize, const i64 vlan, const i64 priority);
 void srcsMapDelete(etcpLAMap_t* const srcConns);
 
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: etcpTcBbr.h
+ *  Description:
+ *  A model based TX TC, for the event driven interface
+ */
+#ifndef SRC_ETCPTCBBR_H_
+#define SRC_ETCPTCBBR_H_
+
+#include <string.h>
+
+#include "types.h"
+#include "utils.h"
+#include "etcpState.h"
+#include "etcpTcRto.h"
+#include "Bbr.h"
+
+/*
+ * For long lived bulk flows. The pacing rate and the window come from a model of the path (see Bbr.h), built from delivery
+ * rates (one per ack of a packet that was only sent once) and the RTT samples from the stack. Each packet's send state is
+ * kept here, by sequence number, until it is ack'd.
+ *
+ * The TC only sees what was sent at its next call, but the stack sends straight after the call, with the same time (see
+ * etcpState_t.nowNs). So packets are taken to have gone out at the time of the call before the one that sees them.
+ *
+ * Pacing is done with maxDat: a new packet is only let out once the pacing gap since the last one has passed, up to
+ * ETCP_TC_BBR_BURST at a time after an idle spell. Resends aren't paced. Lost packets end a probe for more bandwidth early,
+ * the timeouts themselves are left to the fixed RTO TC (see etcpTcRto.h). The urgent lane is left to the fixed RTO TC too.
+ * The model is for one path, so one etcpTcBbr_t is for one connection (see etcpSetTxTcState()). Like the fixed RTO TC, it
+ * can be bound in at compile time (see etcpTcStatic.h).
+ */
+
+#ifndef ETCP_TC_BBR_PKTS_LOG2
+#define ETCP_TC_BBR_PKTS_LOG2 (10) //Packets in flight that can be tracked. Past this, the oldest give no delivery rate
+#endif
+#ifndef ETCP_TC_BBR_BURST
+#define ETCP_TC_BBR_BURST (4) //Most new packets let out at once
+#endif
+
+typedef struct {
+    i64 seq;       //Which packet this is, the slots are reused
+    bool resent;   //Resent packets don't give a delivery rate, which send was ack'd?
+    bbrPkt_t pkt;
+} etcpTcBbrPkt_t;
+
+typedef struct {
+    bbr_t bbr;          //The model
+    etcpTcRto_t rto;    //Retransmit timeouts
+    etcpTcBbrPkt_t pkts[1 << ETCP_TC_BBR_PKTS_LOG2];
+    i64 seqSent;        //etcpTcSummary_t.seqSent last time, to see what has been sent since. <0 before the first call
+    i64 seqQueued;      //etcpTcSummary_t.seqQueued last time, to see if there was anything else to send
+    i64 outstanding;    //etcpTcSummary_t.outstanding last time
+    i64 lastCallNs;     //When the TC was last called, which is when the stack last sent
+    i64 nextTxNs;       //When the next new packet may go
+} etcpTcBbr_t;
+
+
+//Start again. params is given to bbrReset(), NULL for the defaults
+static inline void etcpTcBbrReset(etcpTcBbr_t* const tc, const bbrParams_t* const params)
+{
+    memset(tc,0,sizeof(etcpTcBbr_t));
+    bbrReset(&tc->bbr,params);
+    tc->seqSent = -1;
+    for(i64 i = 0; i < (1 << ETCP_TC_BBR_PKTS_LOG2); i++){
+        tc->pkts[i].seq = -1;
+    }
+}
+
+
+static inline etcpTcBbrPkt_t* etcpTcBbrPkt(etcpTcBbr_t* const tc, const i64 seq)
+{
+    etcpTcBbrPkt_t* const pkt = &tc->pkts[seq & ((1 << ETCP_TC_BBR_PKTS_LOG2) - 1)];
+    return pkt->seq == seq ? pkt : NULL;
+}
+
+
+static inline void etcpTcBbrResent(etcpTcBbr_t* const tc, const i64 from, const i64 count)
+{
+    for(i64 seq = from; seq < from + MIN(count, 1 << ETCP_TC_BBR_PKTS_LOG2); seq++){
+        etcpTcBbrPkt_t* const pkt = etcpTcBbrPkt(tc,seq);
+        if_likely(pkt != NULL){
+            pkt->resent = true;
+        }
+    }
+}
+
+
+static inline void etcpTcBbr(void* const txTcState, const etcpTcSummary_t* const sum, const etcpTcEvt_t* const evts, const i64 evtCount, etcpTcAction_t* const act_io)
+{
+    etcpTcBbr_t* const tc = txTcState;
+
+    const i64 timeouts = tc->rto.timeouts;
+    etcpTcRto(&tc->rto,sum,evts,evtCount,act_io);
+    if_unlikely(sum->rtt == NULL || sum->urgent){
+        return; //Only acks on this lane, or the urgent lane, which is too little to model
+    }
+
+    //What went out after the last call
+    tc->seqSent = tc->seqSent < 0 ? sum->seqUnacked : tc->seqSent;
+    const i64 sentFrom = MAX(tc->seqSent, sum->seqSent - (1 << ETCP_TC_BBR_PKTS_LOG2));
+    for(i64 seq = sentFrom; seq < sum->seqSent; seq++){
+        etcpTcBbrPkt_t* const pkt = &tc->pkts[seq & ((1 << ETCP_TC_BBR_PKTS_LOG2) - 1)];
+        const i64 inflight = tc->outstanding + (seq - tc->seqSent);
+        const bool appLimited = seq + 1 >= tc->seqQueued && inflight + 1 < bbrWindow(&tc->bbr);
+        pkt->seq    = seq;
+        pkt->resent = false;
+        bbrOnSend(&tc->bbr,tc->lastCallNs,inflight,appLimited,&pkt->pkt);
+    }
+
+    //Pacing, the gap is counted from the last call, and there is only so much credit for being idle
+    const i64 paceNs  = bbrPaceNs(&tc->bbr);
+    const i64 sentNew = sum->seqSent - tc->seqSent;
+    if_likely(sentNew > 0){
+        tc->nextTxNs = MAX(tc->nextTxNs, tc->lastCallNs - ETCP_TC_BBR_BURST * paceNs) + sentNew * paceNs;
+    }
+    tc->seqSent = sum->seqSent;
+
+    if_unlikely(tc->rto.timeouts > timeouts){
+        bbrOnTimeout(&tc->bbr);
+        etcpTcBbrResent(tc,act_io->resendFrom,act_io->resendCount);
+    }
+
+    i64 rttNs = -1;
+    i64 ackNs = sum->nowNs;
+    const bbrPkt_t* newest = NULL;
+    i64 newestSeq = -1;
+    for(i64 i = 0; i < evtCount; i++){
+        const etcpTcEvt_t* const evt = &evts[i];
+        switch(evt->type){
+            case etcpTC_ACKED:{
+                ackNs = evt->valNs;
+                //The delivery rate is from the newest packet ack'd that was only sent once
+                for(i64 seq = evt->seq + evt->count - 1; seq >= evt->seq && seq > newestSeq; seq--){
+                    const etcpTcBbrPkt_t* const pkt = etcpTcBbrPkt(tc,seq);
+                    if_likely(pkt != NULL && !pkt->resent){
+                        newest    = &pkt->pkt;
+                        newestSeq = seq;
+                        break;
+                    }
+                }
+                break;
+            }
+            case etcpTC_LOST:{
+                bbrOnLoss(&tc->bbr);
+                etcpTcBbrResent(tc,evt->seq,1);
+                break;
+            }
+            case etcpTC_PROBE:{
+                etcpTcBbrResent(tc,evt->seq,1);
+                break;
+            }
+            case etcpTC_RTT:{
+                rttNs = evt->valNs;
+                break;
+            }
+            default:{
+                break;
+            }
+        }
+    }
+
+    //The ack'd count is from the summary, so the model still sees every delivery if events were dropped. Only the delivery
+    //rate sample may be older than it could have been
+    if_likely(sum->acked > 0 || rttNs >= 0){
+        bbrOnAck(&tc->bbr,ackNs,newest,sum->acked,rttNs,sum->outstanding);
+    }
+
+    //Everything that has been sent may go again (lost packets and resends), but new packets wait for the pacing gap
+    const i64 sent   = sum->seqSent - sum->seqUnacked;
+    const i64 newOk  = sum->nowNs < tc->nextTxNs ? 0 : MIN(1 + (sum->nowNs - tc->nextTxNs) / MAX(paceNs, 1), ETCP_TC_BBR_BURST);
+    act_io->maxDat   = MIN(bbrWindow(&tc->bbr), sent + newOk);
+
+    tc->seqQueued   = sum->seqQueued;
+    tc->outstanding = sum->outstanding;
+    tc->lastCallNs  = sum->nowNs;
+}
+
+#endif /* SRC_ETCPTCBBR_H_ */
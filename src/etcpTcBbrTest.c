@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: etcpTcBbrTest.c
+ *  Description:
+ *  Some very basic sanity checks for the fixed RTO and model based TX TCs, driven through the event interface
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "etcpTcRto.h"
+#include "etcpTcBbr.h"
+#include "RttEstimator.h"
+
+#define TC_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+#define START_NS (1000 * 1000 * 1000LL)
+
+//What the stack fills in before each call
+static etcpTcAction_t actDefaults(const i64 timerNs)
+{
+    const etcpTcAction_t act = {
+        .ackFirst    = true,
+        .maxAck      = -1,
+        .maxDat      = -1,
+        .resendFrom  = 0,
+        .resendCount = 0,
+        .timerNs     = timerNs,
+    };
+    return act;
+}
+
+
+//The timer starts with the first packet and doubles on each timeout in a row, and the backoff belongs to the lane, not to
+//the TC's state
+bool test1()
+{
+    bool result = true;
+    etcpTcRto_t rto = {0};
+
+    etcpTcSummary_t sum = { .nowNs = START_NS, .seqUnacked = 0, .seqSent = 4, .seqQueued = 4, .outstanding = 4 };
+    etcpTcAction_t act  = actDefaults(-1);
+    etcpTcRto(&rto,&sum,NULL,0,&act);
+    TC_ASSERT(act.timerNs == START_NS + ETCP_TC_RTO_NS);
+    TC_ASSERT(act.resendCount == 0);
+
+    //The timer goes off, everything outstanding is resent and the timeout doubles
+    sum.nowNs    = act.timerNs;
+    sum.timeouts = 1;
+    const etcpTcEvt_t timer = { .type = etcpTC_TIMER, .seq = -1, .count = 0, .valNs = sum.nowNs };
+    act = actDefaults(-1);
+    etcpTcRto(&rto,&sum,&timer,1,&act);
+    TC_ASSERT(act.resendFrom == 0 && act.resendCount == 4);
+    TC_ASSERT(act.timerNs == sum.nowNs + 2 * ETCP_TC_RTO_NS);
+    TC_ASSERT(rto.timeouts == 1 && !rto.failed);
+
+    //Another lane on the same state has its own backoff
+    const etcpTcSummary_t urgent = { .nowNs = sum.nowNs, .seqUnacked = 0, .seqSent = 1, .seqQueued = 1, .outstanding = 1, .urgent = true };
+    act = actDefaults(-1);
+    etcpTcRto(&rto,&urgent,NULL,0,&act);
+    TC_ASSERT(act.timerNs == sum.nowNs + ETCP_TC_RTO_NS);
+
+    //Something new ack'd restarts the timer, even when the events were dropped
+    sum.seqUnacked  = 2;
+    sum.outstanding = 2;
+    sum.acked       = 2;
+    sum.timeouts    = 0;
+    sum.evtsDropped = 3;
+    act = actDefaults(sum.nowNs + 2 * ETCP_TC_RTO_NS);
+    etcpTcRto(&rto,&sum,NULL,0,&act);
+    TC_ASSERT(act.timerNs == sum.nowNs + ETCP_TC_RTO_NS);
+    TC_ASSERT(act.resendCount == 0);
+
+    //Too many in a row and it has failed, but it carries on with the longest timeout
+    sum.acked       = 0;
+    sum.evtsDropped = 0;
+    sum.timeouts    = ETCP_TC_RTO_MAX_TIMEOUTS + 1;
+    act = actDefaults(-1);
+    etcpTcRto(&rto,&sum,&timer,1,&act);
+    TC_ASSERT(rto.failed && rto.timeouts == 2);
+    TC_ASSERT(act.resendFrom == 2 && act.resendCount == 2);
+    TC_ASSERT(act.timerNs == sum.nowNs + (ETCP_TC_RTO_NS << ETCP_TC_RTO_MAX_TIMEOUTS));
+
+    //Nothing outstanding, nothing to time out
+    sum.seqUnacked  = 4;
+    sum.outstanding = 0;
+    sum.acked       = 2;
+    sum.timeouts    = 0;
+    act = actDefaults(sum.nowNs + ETCP_TC_RTO_NS);
+    etcpTcRto(&rto,&sum,NULL,0,&act);
+    TC_ASSERT(act.timerNs < 0);
+
+    return result;
+}
+
+
+//Packets are taken to have gone out at the call before the one that sees them, and new packets are paced with maxDat
+bool test2()
+{
+    bool result = true;
+    static etcpTcBbr_t tc;
+    etcpTcBbrReset(&tc,NULL);
+    rttEst_t rtt;
+    rttReset(&rtt,START_NS);
+
+    //Ten packets queued, after being idle only a burst may go
+    etcpTcSummary_t sum = { .nowNs = START_NS, .seqUnacked = 0, .seqSent = 0, .seqQueued = 10, .rtt = &rtt };
+    const etcpTcEvt_t queued = { .type = etcpTC_QUEUED, .seq = 0, .count = 10, .valNs = START_NS };
+    etcpTcAction_t act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,&queued,1,&act);
+    const i64 paceNs = bbrPaceNs(&tc.bbr);
+    TC_ASSERT(paceNs > 0 && paceNs < START_NS / (2 * ETCP_TC_BBR_BURST));
+    TC_ASSERT(act.maxDat == ETCP_TC_BBR_BURST);
+    TC_ASSERT(act.timerNs < 0);
+    TC_ASSERT(etcpTcBbrPkt(&tc,0) == NULL);
+
+    //The burst went out straight after that call. Half a gap later, what is left of the idle credit lets one more go
+    const i64 t1 = START_NS + paceNs / 2;
+    sum.nowNs       = t1;
+    sum.seqSent     = ETCP_TC_BBR_BURST;
+    sum.outstanding = ETCP_TC_BBR_BURST;
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    TC_ASSERT(tc.seqSent == ETCP_TC_BBR_BURST);
+    for(i64 seq = 0; seq < ETCP_TC_BBR_BURST; seq++){
+        const etcpTcBbrPkt_t* const pkt = etcpTcBbrPkt(&tc,seq);
+        TC_ASSERT(pkt != NULL && !pkt->resent);
+        TC_ASSERT(pkt->pkt.sentNs == START_NS);
+    }
+    TC_ASSERT(etcpTcBbrPkt(&tc,ETCP_TC_BBR_BURST) == NULL);
+    TC_ASSERT(act.maxDat == ETCP_TC_BBR_BURST + 1);
+    TC_ASSERT(act.timerNs == t1 + ETCP_TC_RTO_NS);
+
+    //That one went, the next has to wait for the gap
+    sum.seqSent     = ETCP_TC_BBR_BURST + 1;
+    sum.outstanding = ETCP_TC_BBR_BURST + 1;
+    act = actDefaults(t1 + ETCP_TC_RTO_NS);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    TC_ASSERT(etcpTcBbrPkt(&tc,ETCP_TC_BBR_BURST)->pkt.sentNs == t1);
+    TC_ASSERT(act.maxDat == ETCP_TC_BBR_BURST + 1);
+
+    sum.nowNs = START_NS + paceNs;
+    act = actDefaults(t1 + ETCP_TC_RTO_NS);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    TC_ASSERT(act.maxDat == ETCP_TC_BBR_BURST + 2);
+
+    return result;
+}
+
+
+//Acks feed the model, from the summary's count when the events were dropped. A timeout holds the window at one and marks
+//the resends, and the urgent lane is left alone
+bool test3()
+{
+    bool result = true;
+    static etcpTcBbr_t tc;
+    etcpTcBbrReset(&tc,NULL);
+    rttEst_t rtt;
+    rttReset(&rtt,START_NS);
+
+    etcpTcSummary_t sum = { .nowNs = START_NS, .seqUnacked = 0, .seqSent = 0, .seqQueued = 12, .rtt = &rtt };
+    etcpTcAction_t act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    sum.nowNs       = START_NS + 1000;
+    sum.seqSent     = 4;
+    sum.outstanding = 4;
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+
+    //All four ack'd 20us after they went
+    const i64 rttNs = 20 * 1000;
+    rttSample(&rtt,rttNs,START_NS + rttNs);
+    const etcpTcEvt_t acks[] = {
+        { .type = etcpTC_ACKED, .seq = 0, .count = 4, .valNs = START_NS + rttNs },
+        { .type = etcpTC_RTT,   .seq = 3, .count = 4, .valNs = rttNs },
+    };
+    sum.nowNs       = START_NS + rttNs + 1000;
+    sum.seqUnacked  = 4;
+    sum.outstanding = 0;
+    sum.acked       = 4;
+    act = actDefaults(START_NS + 1000 + ETCP_TC_RTO_NS);
+    etcpTcBbr(&tc,&sum,acks,2,&act);
+    TC_ASSERT(tc.bbr.delivered == 4);
+    TC_ASSERT(tc.bbr.minRttNs == rttNs);
+    TC_ASSERT(tc.bbr.btlBwPps > 0);
+    TC_ASSERT(etcpTcBbrPkt(&tc,3) != NULL);
+
+    //Four more, ack'd with the events dropped
+    const i64 t2 = sum.nowNs;
+    sum.nowNs       = t2 + 1000;
+    sum.seqSent     = 8;
+    sum.outstanding = 4;
+    sum.acked       = 0;
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    TC_ASSERT(etcpTcBbrPkt(&tc,7)->pkt.sentNs == t2);
+
+    sum.nowNs       = t2 + rttNs;
+    sum.seqUnacked  = 8;
+    sum.outstanding = 0;
+    sum.acked       = 4;
+    sum.evtsDropped = 2;
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    TC_ASSERT(tc.bbr.delivered == 8);
+
+    //Four more that are never ack'd
+    const i64 t3 = sum.nowNs;
+    sum.nowNs       = t3 + 1000;
+    sum.seqSent     = 12;
+    sum.outstanding = 4;
+    sum.acked       = 0;
+    sum.evtsDropped = 0;
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,NULL,0,&act);
+    TC_ASSERT(act.timerNs == sum.nowNs + ETCP_TC_RTO_NS);
+
+    sum.nowNs    = act.timerNs;
+    sum.timeouts = 1;
+    const etcpTcEvt_t timer = { .type = etcpTC_TIMER, .seq = -1, .count = 0, .valNs = sum.nowNs };
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&sum,&timer,1,&act);
+    TC_ASSERT(act.resendFrom == 8 && act.resendCount == 4);
+    TC_ASSERT(bbrWindow(&tc.bbr) == 1 && act.maxDat == 1);
+    for(i64 seq = 8; seq < 12; seq++){
+        TC_ASSERT(etcpTcBbrPkt(&tc,seq) != NULL && etcpTcBbrPkt(&tc,seq)->resent);
+    }
+
+    //The urgent lane gets the retransmit timeout, but doesn't touch the model
+    const i64 delivered = tc.bbr.delivered;
+    const etcpTcSummary_t urgent = { .nowNs = sum.nowNs, .seqUnacked = 100, .seqSent = 101, .seqQueued = 101, .outstanding = 1, .acked = 3, .urgent = true, .rtt = &rtt };
+    act = actDefaults(-1);
+    etcpTcBbr(&tc,&urgent,NULL,0,&act);
+    TC_ASSERT(act.maxDat == -1);
+    TC_ASSERT(act.timerNs == sum.nowNs + ETCP_TC_RTO_NS);
+    TC_ASSERT(tc.seqSent == 12 && tc.bbr.delivered == delivered);
+    TC_ASSERT(etcpTcBbrPkt(&tc,100) == NULL);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: TX TC Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: TX TC Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: TX TC Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: etcpTcDelay.h
+ *  Description:
+ *  A delay based TX TC, for the event driven interface
+ */
+#ifndef SRC_ETCPTCDELAY_H_
+#define SRC_ETCPTCDELAY_H_
+
+#include <string.h>
+
+#include "types.h"
+#include "utils.h"
+#include "etcpState.h"
+#include "etcpTcRto.h"
+#include "DelayCc.h"
+
+/*
+ * The window comes from the delay in the fabric (see DelayCc.h), taken from the latency records on the connection (see
+ * etcpLatency_t). With NIC timestamps at both ends, networkNs is the time spent between the NICs there and back, so the
+ * time spent in either host doesn't count. Without them, the host times that can't be measured end up in networkNs too,
+ * and this falls back to reacting to the end to end delay. The time the receiver held the ack back is never counted.
+ *
+ * Lost packets cut the window (once per round trip), and retransmit timeouts take it down to the minimum. Resent packets
+ * don't give latency records, so the latest one is used until there is a new one. The timeouts themselves are left to the
+ * fixed RTO TC (see etcpTcRto.h). Below a window of one packet, packets are paced out, one every RTT / window, except for
+ * the resend after a timeout. The window and pacing are for one flow, so each connection needs its own etcpTcDelay_t (see
+ * etcpSetTxTcState()). Like the fixed RTO TC, it can be bound in at compile time (see etcpTcStatic.h).
+ */
+
+typedef struct {
+    dcc_t dcc;          //The window
+    etcpTcRto_t rto;    //Retransmit timeouts
+    i64 latSeen;        //Latency records used so far, see etcpLatRing_t.count
+    i64 seqSent;        //etcpTcSummary_t.seqSent last time, to see when a new packet has gone out
+    i64 lastTxNs;       //When a new packet was last seen to go out, for pacing
+} etcpTcDelay_t;
+
+
+//Start again, with a window of one packet. params is given to dccReset(), NULL for the defaults
+static inline void etcpTcDelayReset(etcpTcDelay_t* const tc, const dccParams_t* const params)
+{
+    memset(tc,0,sizeof(etcpTcDelay_t));
+    dccReset(&tc->dcc,params);
+}
+
+
+static inline void etcpTcDelay(void* const txTcState, const etcpTcSummary_t* const sum, const etcpTcEvt_t* const evts, const i64 evtCount, etcpTcAction_t* const act_io)
+{
+    etcpTcDelay_t* const tc = txTcState;
+
+    const i64 timeouts = tc->rto.timeouts;
+    etcpTcRto(&tc->rto,sum,evts,evtCount,act_io);
+    if_unlikely(sum->rtt == NULL || sum->urgent){
+        return; //Only acks on this lane, or the urgent lane, which shouldn't wait behind the window
+    }
+
+    const i64 rttNs = sum->rtt->samples > 0 ? sum->rtt->srttNs : 0;
+    if_unlikely(tc->rto.timeouts > timeouts){
+        dccOnTimeout(&tc->dcc,sum->nowNs);
+        tc->lastTxNs = INT64_MIN / 2; //Nothing is getting through, so the resend goes now rather than being paced
+    }
+
+    for(i64 i = 0; i < evtCount; i++){
+        if_unlikely(evts[i].type == etcpTC_LOST){
+            dccOnLoss(&tc->dcc,sum->nowNs,rttNs);
+        }
+    }
+
+    //The ack'd count is from the summary, so the window still grows if events were dropped. The newest delay is the one
+    //that matters, the window only comes down once per round trip anyway
+    const i64 acked = sum->acked;
+    if_likely(acked > 0){
+        i64 delayNs = -1;
+        if_likely(sum->lat->count > tc->latSeen){
+            const etcpLatency_t* const rec = &sum->lat->recs[(sum->lat->count - 1) & ((1 << ETCP_LAT_RING_LOG2) - 1)];
+            delayNs     = rec->networkNs;
+            tc->latSeen = sum->lat->count;
+        }
+        dccOnAck(&tc->dcc,sum->nowNs,delayNs,rttNs,acked);
+    }
+
+    act_io->maxDat = dccWindow(&tc->dcc);
+
+    //Pacing, below a window of one packet
+    if_unlikely(sum->seqSent > tc->seqSent){
+        tc->seqSent  = sum->seqSent;
+        tc->lastTxNs = sum->nowNs;
+    }
+    const i64 paceNs = dccPaceNs(&tc->dcc,rttNs);
+    if_unlikely(paceNs > 0 && sum->nowNs - tc->lastTxNs < paceNs){
+        act_io->maxDat = 0;
+    }
+}
+
+#endif /* SRC_ETCPTCDELAY_H_ */
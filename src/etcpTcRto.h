@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: etcpTcRto.h
+ *  Description:
+ *  A fixed retransmit timeout TX TC, for the event driven interface
+ */
+#ifndef SRC_ETCPTCRTO_H_
+#define SRC_ETCPTCRTO_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+#include "debug.h"
+#include "utils.h"
+#include "etcpState.h"
+
+/*
+ * The timeout is fixed, doubling on each timeout in a row. The count of timeouts in a row is kept by the stack for each
+ * lane (see etcpTcSummary_t.timeouts), so one etcpTcRto_t can look after every connection and the urgent lanes. Everything else (acks straight away, lost packets and probes
+ * resent straight away, as much data as the receiver will take) is what the stack does by default. It is in a header so that
+ * it can be bound in at compile time (see etcpTcStatic.h) as well as used through etcpStateSetTxEvtTc(). The constants can
+ * be changed at compile time too.
+ */
+
+#ifndef ETCP_TC_RTO_NS
+#define ETCP_TC_RTO_NS (1000 * 1000LL) //1ms RTO timeout
+#endif
+#ifndef ETCP_TC_RTO_MAX_TIMEOUTS
+#define ETCP_TC_RTO_MAX_TIMEOUTS (10) //Give up after this many timeouts in a row
+#endif
+
+typedef struct {
+    i64 timeouts; //Retransmit timeouts so far, on any lane
+    bool failed;  //A lane has had more than ETCP_TC_RTO_MAX_TIMEOUTS in a row. The TC carries on, it's up to the user what to do
+} etcpTcRto_t;
+
+
+static inline void etcpTcRto(void* const txTcState, const etcpTcSummary_t* const sum, const etcpTcEvt_t* const evts, const i64 evtCount, etcpTcAction_t* const act_io)
+{
+    etcpTcRto_t* const tc = txTcState;
+
+    bool timeout = false;
+    for(i64 i = 0; i < evtCount; i++){
+        const etcpTcEvt_t* const evt = &evts[i];
+        switch(evt->type){
+            case etcpTC_LOST:
+            case etcpTC_PROBE:{
+                //SACKs have shown a hole, or nothing has been heard about the tail for a while, don't wait for the timeout
+                DBG("PACKET LOST Seq=%li (%s)!\n", evt->seq, evt->type == etcpTC_LOST ? "sacked past" : "tail probe");
+                break;
+            }
+            case etcpTC_TIMER:{
+                timeout = true;
+                break;
+            }
+            default:{
+                break;
+            }
+        }
+    }
+    if(sum->outstanding == 0){
+        act_io->timerNs = -1; //Nothing to time out
+        return;
+    }
+
+    if(timeout){
+        //Slow down a bit, we're sending too hard and not getting acks -- This is where the standard TCP congestion
+        //control would kick in, we've detected loss in the network
+        DBG("PACKETS LOST Seq=%li-%li! Timeouts=%li\n", sum->seqUnacked, sum->seqSent - 1, sum->timeouts);
+        act_io->resendFrom  = sum->seqUnacked;
+        act_io->resendCount = sum->seqSent - sum->seqUnacked;
+        tc->failed = tc->failed || sum->timeouts > ETCP_TC_RTO_MAX_TIMEOUTS;
+        tc->timeouts++;
+    }
+
+    //Start the timer when the first packet goes out, and again each time something new is ack'd. The ack'd count is from
+    //the summary, so it is right even if events were dropped
+    if(timeout || sum->acked > 0 || act_io->timerNs < 0){
+        act_io->timerNs = sum->nowNs + (ETCP_TC_RTO_NS << MIN(sum->timeouts, ETCP_TC_RTO_MAX_TIMEOUTS));
+    }
+}
+
+#endif /* SRC_ETCPTCRTO_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: etcpTcStatic.h
+ *  Description:
+ *  How the stack calls the transmission control (TC), through function pointers or bound in at compile time.
+ */
+#ifndef SRC_ETCPTCSTATIC_H_
+#define SRC_ETCPTCSTATIC_H_
+
+#include "etcpState.h"
+
+/*
+ * By default the TCs are called through the function pointers in etcpState_t, which are set at run time. That costs an
+ * indirect call on every send and recv, and the compiler can't see into a policy that is often only a few comparisons. For
+ * latency critical builds, a TC can be bound in at compile time instead. It is then called directly, so it can be inlined
+ * and its constants folded. The TC needs to be visible at the call sites, so it goes in a header (as static inline) that is
+ * named with ETCP_STATIC_TC_HDR. Then one (or both) of these names the TC itself:
+ *
+ *  ETCP_STATIC_TX_TC      An etcpTxTc_f
+ *  ETCP_STATIC_TX_EVT_TC  An etcpTxEvtTc_f, always used instead of the TX TC
+ *  ETCP_STATIC_RX_TC      An etcpRxTc_f, always used instead of the built-in ack coalescing
+ *
+ * eg: -DETCP_STATIC_TC_HDR='"etcpTcRto.h"' -DETCP_STATIC_TX_EVT_TC=etcpTcRto
+ *
+ * The function pointers given at run time are ignored for a TC that is bound in, but the TC state pointers are still passed
+ * to it. The event driven TX TC is given the connection's own state where there is one, see etcpConn_t.txTcState.
+ */
+
+#if defined(ETCP_STATIC_TC_HDR)
+#include ETCP_STATIC_TC_HDR
+#endif
+
+#if defined(ETCP_STATIC_TX_TC) && defined(ETCP_STATIC_TX_EVT_TC)
+#error "Only one of ETCP_STATIC_TX_TC and ETCP_STATIC_TX_EVT_TC can be bound in"
+#endif
+
+//Where one TX TC is bound in, the call to the other is left as it is, but it is never made so the compiler drops it
+#if defined(ETCP_STATIC_TX_TC)
+    #define etcpTxTcIsEvt(state) (false)
+    #define etcpTxTcCall(state, ...) ETCP_STATIC_TX_TC((state)->etcpTxTcState, __VA_ARGS__)
+    #define etcpTxEvtTcCall(state, tcState, ...) (state)->etcpTxEvtTc((tcState), __VA_ARGS__)
+#elif defined(ETCP_STATIC_TX_EVT_TC)
+    #define etcpTxTcIsEvt(state) (true)
+    #define etcpTxTcCall(state, ...) (state)->etcpTxTc((state)->etcpTxTcState, __VA_ARGS__)
+    #define etcpTxEvtTcCall(state, tcState, ...) ETCP_STATIC_TX_EVT_TC((tcState), __VA_ARGS__)
+#else
+    #define etcpTxTcIsEvt(state) ((state)->etcpTxEvtTc != NULL)
+    #define etcpTxTcCall(state, ...) (state)->etcpTxTc((state)->etcpTxTcState, __VA_ARGS__)
+    #define etcpTxEvtTcCall(state, tcState, ...) (state)->etcpTxEvtTc((tcState), __VA_ARGS__)
+#endif
+
+#if defined(ETCP_STATIC_RX_TC)
+    #define etcpRxTcIsSet(state) (true)
+    #define etcpRxTcCall(state, ...) ETCP_STATIC_RX_TC((state)->etcpRxTcState, __VA_ARGS__)
+#else
+    #define etcpRxTcIsSet(state) ((state)->etcpRxTc != NULL)
+    #define etcpRxTcCall(state, ...) (state)->etcpRxTc((state)->etcpRxTcState, __VA_ARGS__)
+#endif
+
+#endif /* SRC_ETCPTCSTATIC_H_ */
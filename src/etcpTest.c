@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2016, All rights reserved.
+ * See LICENSE.txt for full details.
+ *
+ *  Created:   18 Oct 2026
+ *  File name: etcpTest.c
+ *  Description:
+ *  Some very basic sanity checks for the whole stack, two states talking over an in-memory wire
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "etcpSockApi.h"
+#include "etcpState.h"
+#include "FastCopy.h"
+#include "packets.h"
+
+#define ETCP_ASSERT(p) do { if(!(p)) { fprintf(stdout, "Error in %s: failed assertion \""#p"\" on line %u\n", __FUNCTION__, __LINE__); result = 0; return result; } } while(0)
+
+#define TEST_FRAMES     (256)
+#define TEST_FRAME_SIZE (2048 + 64)
+#define START_NS        (1000 * 1000 * 1000LL)
+
+//One direction of the wire
+typedef struct {
+    i8 frames[TEST_FRAMES][TEST_FRAME_SIZE];
+    i64 lens[TEST_FRAMES];
+    i64 rd;
+    i64 wr;
+} testWire_t;
+
+typedef struct {
+    testWire_t* tx;
+    testWire_t* rx;
+    uint64_t lose; //Data packets (by seq, first transmission only) that are lost on the way
+    i64 parity;    //Parity packets sent
+} testPort_t;
+
+//Sends new data straight away, and resends only when told to, so that the test decides what recovers what
+typedef struct {
+    bool resend;
+} testTc_t;
+
+
+static int64_t testTx(void* const hwState, const void* const data, const int64_t len, uint64_t* const hwTxTimeNs)
+{
+    testPort_t* const port = hwState;
+    *hwTxTimeNs = 0;
+
+    const etcpMsgHead_t* const head = (const etcpMsgHead_t*)((const i8*)data + ETH_HLEN);
+    port->parity += head->type == ETCP_FEC;
+    if(head->type == ETCP_DAT){
+        const etcpMsgDatHdr_t* const datHdr = (const etcpMsgDatHdr_t*)(head + 1);
+        if(!datHdr->skipDat && datHdr->txAttempts == 0 && datHdr->seqNum < 64 && (port->lose >> datHdr->seqNum) & 1){
+            return len;
+        }
+    }
+
+    testWire_t* const wire = port->tx;
+    memcpy(wire->frames[wire->wr % TEST_FRAMES],data,len);
+    wire->lens[wire->wr % TEST_FRAMES] = len + ETH_FCS_LEN;
+    wire->wr++;
+    return len;
+}
+
+
+static int64_t testRx(void* const hwState, void* const data, const int64_t len, uint64_t* const hwRxTimeNs)
+{
+    testPort_t* const port = hwState;
+    testWire_t* const wire = port->rx;
+    *hwRxTimeNs = 0;
+    if(wire->rd == wire->wr){
+        return 0;
+    }
+
+    const i64 frameLen = MIN(wire->lens[wire->rd % TEST_FRAMES], len);
+    memcpy(data,wire->frames[wire->rd % TEST_FRAMES],frameLen);
+    wire->rd++;
+    return frameLen;
+}
+
+
+static void testTxTc(void* const txTcState, const cq_t* const datTxQ, const cq_t* ackRxQ, cq_t* ackTxQ, const cq_t* const datRxQ, const rttEst_t* const datRtt, const etcpLatRing_t* const datLat, bool* const ackFirst, i64* const maxAck_o, i64* const maxDat_o)
+{
+    const testTc_t* const tc = txTcState;
+    (void)ackRxQ;
+    (void)datRxQ;
+    (void)datRtt;
+    (void)datLat;
+    *ackFirst = true;
+    *maxAck_o = -1;
+    *maxDat_o = -1;
+
+    cqSlot_t* slot = NULL;
+    for(i64 i = ackTxQ ? ackTxQ->rdMin : 0; ackTxQ && i < ackTxQ->rdMax; i++){
+        if(cqGetRd(ackTxQ,&slot,i) == cqENOERR){
+            ((pBuff_t*)slot->buff)->txState = ETCP_TX_NOW;
+        }
+    }
+
+    for(i64 i = datTxQ ? datTxQ->rdMin : 0; datTxQ && i < datTxQ->rdMax; i++){
+        if(cqGetRd(datTxQ,&slot,i) == cqENOERR){
+            pBuff_t* const pBuff = slot->buff;
+            pBuff->txState = pBuff->etcpDatHdr->txAttempts == 0 || tc->resend ? ETCP_TX_NOW : pBuff->txState;
+        }
+    }
+}
+
+
+static void testRxTc(void* const rxTcState, const cq_t* const datRxQ, const ll_t* datStaleQ, const cq_t* const ackTxQ, i64* const maxAckSlots_o, i64* const maxAckPkts_o, i64* const maxStaleSlots_o, i64* const maxStaleAckPkts_o)
+{
+    (void)rxTcState;
+    (void)datRxQ;
+    (void)datStaleQ;
+    (void)ackTxQ;
+    *maxAckSlots_o     = -1;
+    *maxAckPkts_o      = -1;
+    *maxStaleSlots_o   = -1;
+    *maxStaleAckPkts_o = -1;
+}
+
+
+//Event driven TX TC that only counts the calls with each state, and leaves everything else to the stack
+static void testEvtTc(void* const txTcState, const etcpTcSummary_t* const sum, const etcpTcEvt_t* const evts, const i64 evtCount, etcpTcAction_t* const act_io)
+{
+    (void)sum;
+    (void)evts;
+    (void)evtCount;
+    (void)act_io;
+    (*(i64*)txTcState)++;
+}
+
+
+static i64 testNowNs(void* const clkState)
+{
+    return *(const i64*)clkState;
+}
+
+
+static etcpError_t testSend(etcpSocket_t* const sock, const i64 msg, const i64 deadlineNs)
+{
+    char buff[32];
+    i64 len = snprintf(buff,sizeof(buff),"message %li",msg) + 1;
+    return etcpSend(sock,buff,&len,deadlineNs);
+}
+
+
+static etcpError_t testSendStream(etcpSocket_t* const sock, const i64 streamId, const i64 msg)
+{
+    char buff[32];
+    i64 len = snprintf(buff,sizeof(buff),"message %li",msg) + 1;
+    return etcpSendStream(sock,streamId,buff,&len,ETCP_NO_DEADLINE);
+}
+
+
+//Two states talking to each other, A connects to B
+typedef struct {
+    testWire_t aToB;
+    testWire_t bToA;
+    testPort_t portA;
+    testPort_t portB;
+    testTc_t tcA;
+    testTc_t tcB;
+    i64 nowNs;
+    etcpState_t* sa;
+    etcpState_t* sb;
+    etcpSocket_t* tx; //A's end
+    etcpSocket_t* ls; //B listening
+    etcpSocket_t* rx; //B's end, once accepted
+} testStack_t;
+
+
+static bool testStackNew(testStack_t* const ts, const uint64_t lose, const i64 fecLog2)
+{
+    memset(ts,0,sizeof(testStack_t));
+    ts->portA = (testPort_t){ .tx = &ts->aToB, .rx = &ts->bToA, .lose = lose };
+    ts->portB = (testPort_t){ .tx = &ts->bToA, .rx = &ts->aToB };
+    ts->nowNs = START_NS;
+
+    ts->sa = etcpStateNew(&ts->portA,testTx,testRx,testTxTc,&ts->tcA,true,testRxTc,NULL,true);
+    ts->sb = etcpStateNew(&ts->portB,testTx,testRx,testTxTc,&ts->tcB,true,testRxTc,NULL,true);
+    if(ts->sa == NULL || ts->sb == NULL){
+        return false;
+    }
+    etcpStateSetClock(ts->sa,clkUSER,testNowNs,&ts->nowNs);
+    etcpStateSetClock(ts->sb,clkUSER,testNowNs,&ts->nowNs);
+
+    ts->tx = etcpSocketNew(ts->sa);
+    ts->ls = etcpSocketNew(ts->sb);
+    return etcpConnect(ts->tx,4,2048,1,15,2,14,true,-1,-1) == etcpENOERR &&
+           (fecLog2 == 0 || etcpSetFec(ts->tx,fecLog2) == etcpENOERR) &&
+           etcpBind(ts->ls,4,2048,2,14,-1,-1) == etcpENOERR &&
+           etcpListen(ts->ls,2) == etcpENOERR;
+}
+
+
+//B only hears about the connection once something arrives for it
+static bool testAccept(testStack_t* const ts)
+{
+    for(i64 i = 0; i < 4 && etcpAccept(ts->ls,&ts->rx) == etcpETRYAGAIN; i++){}
+    return ts->rx != NULL;
+}
+
+
+//Let both ends receive, ack and send whatever is waiting
+static void testPump(testStack_t* const ts)
+{
+    i64 zero = 0;
+    for(i64 i = 0; i < 4; i++){
+        etcpRecv(ts->rx,NULL,NULL);
+        etcpSend(ts->rx,NULL,&zero,ETCP_NO_DEADLINE);
+        etcpRecv(ts->tx,NULL,NULL);
+        etcpSend(ts->tx,NULL,&zero,ETCP_NO_DEADLINE);
+    }
+}
+
+
+//Expect the next message to be msg, or nothing at all for msg < 0
+static bool testRecv(etcpSocket_t* const sock, const i64 msg)
+{
+    char expected[32];
+    snprintf(expected,sizeof(expected),"message %li",msg);
+    char buff[32] = {0};
+    i64 len = sizeof(buff);
+    const etcpError_t err = etcpRecv(sock,buff,&len);
+    return msg < 0 ? err == etcpETRYAGAIN : err == etcpENOERR && strcmp(buff,expected) == 0;
+}
+
+
+//The error from receiving on a stream, with anything received checked against msg
+static etcpError_t testRecvStream(etcpSocket_t* const sock, const i64 streamId, const i64 msg)
+{
+    char expected[32];
+    snprintf(expected,sizeof(expected),"message %li",msg);
+    char buff[32] = {0};
+    i64 len = sizeof(buff);
+    const etcpError_t err = etcpRecvStream(sock,streamId,buff,&len);
+    return err == etcpENOERR && strcmp(buff,expected) != 0 ? etcpEFATAL : err;
+}
+
+
+//A message that has already gone out (and so is in its group's parity) expires and is replaced by a skip marker, while
+//another packet of the group is lost. The receiver must not rebuild the lost packet from parity that doesn't match what it
+//has, the lost packet comes through intact on the resend.
+bool test1()
+{
+    bool result = true;
+    static testStack_t ts;
+    ETCP_ASSERT(testStackNew(&ts,(1 << 1) | (1 << 2),2));
+
+    //1 is only worth anything for a moment, 1 and 2 are lost
+    ETCP_ASSERT(testSend(ts.tx,0,ETCP_NO_DEADLINE) == etcpENOERR);
+    ETCP_ASSERT(testSend(ts.tx,1,ts.nowNs + 1000) == etcpENOERR);
+    ETCP_ASSERT(testSend(ts.tx,2,ETCP_NO_DEADLINE) == etcpENOERR);
+    ETCP_ASSERT(testAccept(&ts));
+
+    //1 expires, so a skip marker goes in its place. Then 3 completes the group and the parity goes
+    ts.nowNs += 2000;
+    testPump(&ts);
+    ETCP_ASSERT(testSend(ts.tx,3,ETCP_NO_DEADLINE) == etcpENOERR);
+    testPump(&ts);
+    ETCP_ASSERT(ts.portA.parity == 1);
+
+    //Only 2 is missing, but the parity has 1 in it as it was, not the skip marker
+    ETCP_ASSERT(testRecv(ts.rx,0));
+    ETCP_ASSERT(testRecv(ts.rx,-1));
+
+    ts.tcA.resend = true;
+    testPump(&ts);
+    ETCP_ASSERT(testRecv(ts.rx,2));
+    ETCP_ASSERT(testRecv(ts.rx,3));
+    ETCP_ASSERT(testRecv(ts.rx,-1));
+
+    return result;
+}
+
+
+//A burst goes out in one pass, so every packet in it has the same send time. The ack for it is still only one round trip.
+bool test2()
+{
+    bool result = true;
+    static testStack_t ts;
+    ETCP_ASSERT(testStackNew(&ts,0,0));
+
+    for(i64 i = 0; i < 4; i++){
+        ETCP_ASSERT(testSend(ts.tx,i,ETCP_NO_DEADLINE) == etcpENOERR);
+    }
+    ETCP_ASSERT(testAccept(&ts));
+    ts.nowNs += 1000;
+    testPump(&ts);
+
+    for(i64 i = 0; i < 4; i++){
+        ETCP_ASSERT(testRecv(ts.rx,i));
+    }
+    etcpLatency_t recs[8];
+    ETCP_ASSERT(etcpSendLatency(ts.tx,recs,8) == 1);
+    ETCP_ASSERT(recs[0].rttNs == 1000);
+
+    return result;
+}
+
+
+//Streams are only opened locally. Data for a stream the receiver hasn't opened is dropped, not given somewhere to live, and
+//comes through once the receiver opens it.
+bool test3()
+{
+    bool result = true;
+    static testStack_t ts;
+    ETCP_ASSERT(testStackNew(&ts,0,0));
+
+    ETCP_ASSERT(etcpOpenStream(ts.tx,ETCP_MAX_STREAMS) == etcpERANGE);
+    ETCP_ASSERT(testSendStream(ts.tx,3,0) == etcpERANGE);
+    ETCP_ASSERT(etcpOpenStream(ts.tx,3) == etcpENOERR);
+    ETCP_ASSERT(testSendStream(ts.tx,3,0) == etcpENOERR);
+    ETCP_ASSERT(testAccept(&ts));
+    testPump(&ts);
+    ETCP_ASSERT(testRecvStream(ts.rx,3,0) == etcpERANGE);
+
+    ETCP_ASSERT(etcpOpenStream(ts.rx,3) == etcpENOERR);
+    ts.tcA.resend = true;
+    testPump(&ts);
+    ETCP_ASSERT(testRecvStream(ts.rx,3,0) == etcpENOERR);
+    ETCP_ASSERT(testRecv(ts.rx,-1));
+
+    return result;
+}
+
+
+//Bulk data is streamed into the user's buffer, the stack has no more use for it. Urgent data isn't.
+bool test4()
+{
+    bool result = true;
+    static testStack_t ts;
+    ETCP_ASSERT(testStackNew(&ts,0,0));
+
+    ETCP_ASSERT(testSend(ts.tx,0,ETCP_NO_DEADLINE) == etcpENOERR);
+    char buff[32] = "message 1";
+    i64 len = strlen(buff) + 1;
+    ETCP_ASSERT(etcpSendUrgent(ts.tx,buff,&len,ETCP_NO_DEADLINE) == etcpENOERR);
+    ETCP_ASSERT(testAccept(&ts));
+    testPump(&ts);
+
+    const i64 streamed = fcStreamCount();
+    len = sizeof(buff);
+    ETCP_ASSERT(etcpRecvUrgent(ts.rx,buff,&len) == etcpENOERR && strcmp(buff,"message 1") == 0);
+    ETCP_ASSERT(fcStreamCount() == streamed);
+    ETCP_ASSERT(testRecv(ts.rx,0));
+    ETCP_ASSERT(fcStreamCount() == streamed + 1);
+
+    return result;
+}
+
+
+//A socket with its own TC state has the event driven TC called with that, not the state that the stack shares
+bool test5()
+{
+    bool result = true;
+    static testStack_t ts;
+    ETCP_ASSERT(testStackNew(&ts,0,0));
+    i64 shared = 0;
+    i64 own    = 0;
+    etcpStateSetTxEvtTc(ts.sa,testEvtTc,&shared);
+    ETCP_ASSERT(etcpSetTxTcState(ts.tx,&own) == etcpENOERR);
+
+    ETCP_ASSERT(testSend(ts.tx,0,ETCP_NO_DEADLINE) == etcpENOERR);
+    ETCP_ASSERT(testAccept(&ts));
+    testPump(&ts);
+    ETCP_ASSERT(testRecv(ts.rx,0));
+    ETCP_ASSERT(own > 0 && shared == 0);
+
+    ETCP_ASSERT(etcpSetTxTcState(ts.tx,NULL) == etcpENOERR);
+    const i64 ownCalls = own;
+    ETCP_ASSERT(testSend(ts.tx,1,ETCP_NO_DEADLINE) == etcpENOERR);
+    testPump(&ts);
+    ETCP_ASSERT(testRecv(ts.rx,1));
+    ETCP_ASSERT(own == ownCalls && shared > 0);
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    i64 test_pass = 0;
+    printf("ETCP Data Structures: Stack Test 01: ");  printf("%s", (test_pass = test1()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Stack Test 02: ");  printf("%s", (test_pass = test2()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Stack Test 03: ");  printf("%s", (test_pass = test3()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Stack Test 04: ");  printf("%s", (test_pass = test4()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    printf("ETCP Data Structures: Stack Test 05: ");  printf("%s", (test_pass = test5()) ? "PASS\n" : "FAIL\n"); if(!test_pass) return 1;
+    return 0;
+}
@@ -10,11 +10,14 @@
 #ifndef SRC_PACKETS_H_
 #define SRC_PACKETS_H_
 
+#include <stdbool.h>
 #include <linux/if_ether.h>
 
 typedef struct __attribute__((packed)){
     //Note 1: Client and server times cannot be compared unless there is some kind of time synchronisation (eg PTP)
-    //Note 2: Hardware cycle counts and software times cannot be compared unless there is time synchronisation and conversion
+    //Note 2: Hardware cycle counts and software times cannot be compared unless there is time synchronisation and conversion.
+    //        Ports with a clock model (see etcpStateSetHwClock()) convert their hardware times into software time as they
+    //        come in, so for those they can be.
     //Note 3: To save space, some times are 32bits only, which assumes that time differences will be <4 seconds.
     //Note 4: Assumption 3 can be checked using swRxTimeNs - swTxTimeNs which is the absolute unix time.
     uint64_t swTxTimeNs;   //Client Unix time in ns, used for RTT time estimation
@@ -32,11 +35,14 @@ _Static_assert(sizeof(etcpSackField_t) == 1 * sizeof(uint64_t) , "Don't let this
 
 typedef struct __attribute__((packed)){
     i64 sackBaseSeq;
-    uint64_t sackCount    : 8;  //Max 256 sack fields in a packet (256*32B = 8192B ~= 1 jumbo frame)
-    uint64_t reserved     : 24; //Not in use right now
-    uint64_t rxWindowSegs : 32; //Max 4B segment buffers in the rx window
+    uint64_t sackCount    : 16; //Max 65K sack fields in a packet, more than fit in a jumbo frame
+    uint64_t urgent       : 1;  //These acks are for the urgent lane sequence space, not the bulk one
+    uint64_t cumAck       : 1;  //Everything below sackBaseSeq has been received too, the fields are only what is beyond it
+    uint64_t reserved     : 14; //Not in use right now
+    uint64_t rxWindowSegs : 32; //With cumAck, the receiver has room for everything below sackBaseSeq + rxWindowSegs
     etcpTime_t timeFirst;
     etcpTime_t timeLast;
+    i64 timeLastSeq;            //The seq of the packet that timeLast came from, so the sender can find its own copy
 } etcpMsgSackHdr_t;
 
 typedef struct __attribute__((packed)){
@@ -49,9 +55,43 @@ typedef struct __attribute__((packed)){
     //Keeping this state here beacuse I can. It could be in some kind of meta structure, but I have the bits here anyway
     uint16_t ackSent    :  1; //Has the ack for this packet been sent? Only pass the packet up to the user if it has.
     uint16_t staleDat   :  1; //Has this packet already been seen before. If so, don't give it back to the user
-    uint16_t reserved   : 12; //Nothing here
+    uint16_t skipDat    :  1; //The sender gave up on this packet (deadline expired). No payload, skip over it, don't deliver
+    uint16_t urgent     :  1; //Packet belongs to the urgent lane, which has its own sequence space and queues
+    uint16_t fecLog2    :  3; //Packet is covered by a parity packet for its group of 2^fecLog2 packets, 0 = no parity
+    uint16_t dupTx      :  1; //Every transmission of this packet is sent twice, on two ports, so expect duplicates
+    uint16_t ackNow     :  1; //The sender is waiting on this one, ack it straight away rather than holding it to coalesce
+    uint16_t reserved   :  5; //Nothing here
+
+    uint64_t streamId   :  8; //Stream within the connection. Each stream is its own ordering domain. Max 64 streams (ETCP_MAX_STREAMS)
+    uint64_t streamSeq  : 56; //Sequence number within the stream, only used to order delivery to the user
 } etcpMsgDatHdr_t;
 
+//Forward error correction. The sender splits the data sequence space into groups of 2^groupSizeLog2 packets, each one
+//starting at a multiple of the group size. Once every packet in a group has been sent, the sender sends the XOR of all of
+//them in a parity packet. A receiver that is missing exactly one packet of the group can rebuild it without waiting for a
+//retransmit. The parity payload covers a short summary of each data header (below), followed by the data itself. Shorter
+//packets are zero padded to the longest one in the group.
+typedef struct __attribute__((packed)){
+    uint64_t seqBase;           //First data sequence number of the group
+    uint64_t groupSizeLog2 : 8; //Number of data packets in the group (log2)
+    uint64_t urgent        : 1; //Parity for the urgent lane sequence space, not the bulk one
+    uint64_t reserved      : 23;
+    uint64_t parityLen     : 32; //Length of the parity payload, which follows this header
+} etcpMsgFecHdr_t;
+
+//The parts of the data header that the receiver can't work out for itself for a rebuilt packet
+typedef struct __attribute__((packed)){
+    uint32_t datLen;
+    uint16_t noAck      :  1;
+    uint16_t noRet      :  1;
+    uint16_t skipDat    :  1;
+    uint16_t reserved   : 13;
+    uint16_t streamId;
+    uint64_t streamSeq;
+} etcpFecDatSummary_t;
+
+_Static_assert(sizeof(etcpFecDatSummary_t) == 2 * sizeof(uint64_t) , "Parity covers this for every packet, keep it small");
+
 //Assumes a fast layer 2 network (10G plus), with built in check summing and reasonable latency. In this case, sending
 //more bits, is better than sending many more packets at higher latency. Keep this generic header pretty minimal, but use nice
 //large types without too many range restrictions.
@@ -66,6 +106,9 @@ typedef enum {
     //Uses the acknowledgement packet format
     ETCP_ACK = 0x04, //Contains acknowledgement fields
 
+    //Uses the parity packet format
+    ETCP_FEC = 0x05, //Parity over a group of data packets
+
 } etcpMsgType_t;
 
 typedef struct __attribute__((packed)){
@@ -99,7 +142,8 @@ typedef struct __attribute__((packed)){
 } etcpMsgHead_t;
 _Static_assert(sizeof(etcpMsgHead_t) == 7 * sizeof(uint64_t) , "Don't let this grow too big, 48B is big enough!");
 
-//This is arbitrarily set, to get a nice number of sacks, but make the packet not too big (~256B)
+//This is arbitrarily set, to get a nice number of sacks, but make the packet not too big (~256B). Stale acks are still made this
+//size, other acks can grow bigger, see ETCP_SACK_MTU below.
 //TODO XXX reevaluate this later to see if the trade-off is ok. Should it be bigger or smaller or am I so awesome that I got
 //it right first guess (unlikely...).
 //Current sizes: 256B Max packet
@@ -116,6 +160,13 @@ _Static_assert(sizeof(etcpMsgHead_t) == 7 * sizeof(uint64_t) , "Don't let this g
 #define ETCP_MAX_SACKS ( (i64)((ETCP_MAX_SACK_PKT - ETCP_ETH_OVERHEAD - ETCP_SACKHDR_OVERHEAD) / (sizeof(etcpSackField_t))) )
 _Static_assert(ETCP_MAX_SACKS >= 10 , "Make sure there is some reasonable number of sacks available");
 
+//Sack packets are only as big as the fields in them, so with a few holes (the usual case) they stay small. Under scattered
+//loss, a packet grows to fit as many fields as it needs, up to a full frame (if the connection's slots are big enough), so
+//that recovering from a burst of losses doesn't take dozens of ack packets.
+#define ETCP_SACK_MTU (1500LL) //Ethernet payload, not including the Ethernet header
+#define ETCP_MAX_SACKS_MTU ( (i64)((ETCP_SACK_MTU - ETCP_SACKHDR_OVERHEAD) / (sizeof(etcpSackField_t))) )
+_Static_assert(ETCP_MAX_SACKS_MTU < (1 << 16), "Make sure that a full frame of sacks can be counted in sackCount");
+
 #define ETCP_MAGIC 0x45544350ULL //"ETCP" in ASCII
 #define ETCP_V1 0x1ULL
 #define ETCP_V1_FULLHEAD(MSG) ((ETCP_MAGIC << 16) + (ETCP_V1 << 8) + (MSG << 0) )
@@ -129,6 +180,11 @@ typedef enum {
 
 typedef struct {
     txState_t txState;
+    i64 deadlineNs; //Local only. Absolute time (ns) after which the packet is worthless and will be dropped, 0 = never
+    i64 txPath;     //Local only. The connection path the packet last went out on, -1 if the connection is not striping
+    i64 txOrder;    //Local only. When the packet last went out, counted in data transmissions on the connection
+    bool lost;      //Local only. Presumed lost, because later transmissions have been ack'd. The TC should resend it now.
+    bool probe;     //Local only. Tail loss probe, nothing has been heard for a while. The TC should resend it now.
 
     void* buffer;
     i64 buffSize; //Size of the buffer area to work in
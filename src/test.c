@@ -8,11 +8,15 @@
 #include <exanic/fifo_rx.h>
 #include <exanic/fifo_tx.h>
 #include <exanic/time.h>
+#include <exanic/pcie_if.h>
 
 #include "src/etcpSockApi.h"
 #include "src/debug.h"
 #include "src/CircularQueue.h"
 #include "src/packets.h"
+#include "src/etcpTcRto.h"
+#include "src/etcpTcDelay.h"
+#include "src/etcpTcBbr.h"
 
 
 static etcpState_t* etcpState = NULL;
@@ -21,14 +25,18 @@ typedef struct  {
     exanic_t* dev;
     exanic_rx_t* rxBuff;
     exanic_tx_t* txBuff;
+    int64_t txCount;  //Frames sent so far
+    int64_t txTsNext; //First frame that hasn't had its TX timestamp looked at yet
+    uint64_t clkCycles; //NIC clock (cycles, extended to 64 bits) at the last exanicClk(), for extending the frame timestamps
 } exaNicState_t;
 exaNicState_t nicState;
 
 
-typedef struct {
-    i64 foo;
-} tcState_t;
-tcState_t tcState;
+etcpTcRto_t tcRto;     //See etcpTcRto.h
+etcpTcDelay_t tcDelay; //See etcpTcDelay.h
+etcpTcBbr_t tcBbr;     //See etcpTcBbr.h
+const etcpTcRto_t* tcTimeouts = &tcRto; //The retransmit timeouts of whichever TC is in use
+const char* tcName = "rto";
 
 int etcptpTestClient()
 {
@@ -43,6 +51,14 @@ int etcptpTestClient()
     }
 
 
+    //Throughput and queueing, to compare the TCs. Queueing is how far the RTTs are above the lowest one.
+    const i64 startNs = clkRealtimeNs();
+    i64 rttCount   = 0;
+    i64 rttTotalNs = 0;
+    i64 rttMinNs   = INT64_MAX;
+    i64 rttMaxNs   = 0;
+    i64 latSeenNs  = -1;
+
     i64 pkts = 0;
     i64 i = 1;
     for(;i<16000;i++){
@@ -50,7 +66,7 @@ int etcptpTestClient()
 
         //DBG("Client sending packet %li\n", pkts);
         i64 toSendLen = len;
-        etcpSend(sock,dat,&toSendLen);
+        etcpSend(sock,dat,&toSendLen,ETCP_NO_DEADLINE);
         if(toSendLen > 0){
             //DBG("Sent %li bytes\n", toSendLen);
             pkts++;
@@ -59,8 +75,28 @@ int etcptpTestClient()
         //Trigger an RX to see if there is an ack
         etcpRecv(sock,NULL,NULL);
 
+        etcpLatency_t lat;
+        if(etcpSendLatency(sock,&lat,1) == 1 && lat.timeNs != latSeenNs && lat.rttNs >= 0){
+            latSeenNs = lat.timeNs;
+            rttCount++;
+            rttTotalNs += lat.rttNs;
+            rttMinNs = MIN(rttMinNs, lat.rttNs);
+            rttMaxNs = MAX(rttMaxNs, lat.rttNs);
+        }
+
+        if(tcTimeouts->failed){
+            ERR("Too many retransmit timeouts, giving up\n");
+            return -1;
+        }
+
         //sleep(5); //Rest for a bit
     }
+
+    const i64 elapsedNs = clkRealtimeNs() - startNs;
+    const i64 rttMeanNs = rttCount > 0 ? rttTotalNs / rttCount : -1;
+    printf("%s TC: %li packets in %lius, %.0f packets/s, RTT min/mean/max %li/%li/%lins, queueing %lins\n",
+            tcName, pkts, elapsedNs / 1000, (double)pkts * 1000 * 1000 * 1000 / (double)MAX(elapsedNs, 1),
+            rttCount > 0 ? rttMinNs : -1, rttMeanNs, rttCount > 0 ? rttMaxNs : -1, rttCount > 0 ? rttMeanNs - rttMinNs : -1);
     //Close the connection
     etcpClose(sock);
 
@@ -92,7 +128,7 @@ int etcptpTestServer()
         i64 len = 128;
         etcpError_t recvErr = etcpETRYAGAIN;
         for(recvErr = etcpETRYAGAIN; recvErr == etcpETRYAGAIN; recvErr = etcpRecv(accSock,&data,&len)){
-            etcpSend(accSock,NULL,0);
+            etcpSend(accSock,NULL,0,ETCP_NO_DEADLINE);
             __asm__ __volatile__ ("pause"); //Tell CPU to relax
         }
 
@@ -108,7 +144,7 @@ int etcptpTestServer()
 //        }
 
         //Trigger the ACK send
-        etcpSend(accSock,NULL,0);
+        etcpSend(accSock,NULL,0,ETCP_NO_DEADLINE);
     }
 
     //Close the connection
@@ -119,133 +155,71 @@ int etcptpTestServer()
 }
 
 
-//Returns: >0 this is the number of acknowledgement packets that can be generated. <=0 no ack packets will be generated
-void etcpRxTc(void* const rxTcState, const cq_t* const datRxQ, const ll_t* datStaleQ, const cq_t* const ackTxQ, i64* const maxAckSlots_o, i64* const maxAckPkts_o,  i64* const maxStaleSlots_o,  i64* const maxStaleAckPkts_o  )
+//The ETCP internal state expects to be provided with hardware send and receive operations, these typedefs spell them out
+//A generic wrapper around the "hardware" tx layer
+//Returns: >0, number of bytes transmitted =0, no send capacity, try again, <0 hw specific error code
+static int64_t exanicTx(void* const hwState, const void* const data, const int64_t len, uint64_t* const hwTxTimeNs )
 {
-    DBG("RX TC Called!\n");
-    (void)rxTcState;
-    (void)datRxQ;
-    (void)ackTxQ;
-    (void)datStaleQ;
-
+    exaNicState_t* const exaNicState = hwState;
 
+    //hexdump(data,len);
+    ssize_t result = exanic_transmit_frame(exaNicState->txBuff,(const char*)data, len);
+    if(result > 0){
+        exaNicState->txCount++;
+    }
+    *hwTxTimeNs = 0; //Don't wait for it here, it's collected later by exanicTxTs()
+    return result;
+}
 
-//    int i = datRxQ->rdMin;
-//    for(; i < datRxQ->rdMax; i++){
-//        cqSlot_t* slot = NULL;
-//        //DBG("Getting slot/seq=%li\n", i);
-//        cqError_t cqe = cqGetRd(datRxQ,&slot,i);
-//        if(cqe != cqENOERR){
-//            break;
-//        }
-//
-//        etcpMsgHead_t* const head = (etcpMsgHead_t* const)slot->buff;
-//        etcpMsgDatHdr_t* const datHdr = (etcpMsgDatHdr_t*)(head +1);
-//        //DBG("Got a data packet with seq no %li packet status is %li\n", datHdr->seqNum, slot->valid ? 1 : 0);
-//
-//    }
-//
-//    llSlot_t* slot = NULL;
-//    for(llError_t err = llGetFirst(datStaleQ,&slot); err == llENOERR; err = llGetNext(datStaleQ,&slot) ){
-//        etcpMsgHead_t* const head = (etcpMsgHead_t* const)slot->buff;
-//        etcpMsgDatHdr_t* const datHdr = (etcpMsgDatHdr_t*)(head +1);
-//        //DBG("Got a data packet with seq no %li\n", datHdr->seqNum);
-//    }
 
-    *maxAckPkts_o      = -1;
-    *maxAckSlots_o     = -1;
-    *maxStaleSlots_o   = -1;
-    *maxStaleAckPkts_o = -1;
+//The NIC timestamps frames with the bottom 32 bits of its cycle counter. Extend them to 64 bits from the last time the clock
+//was read (see exanicClk()), which is much more recent than the 32 bit counter takes to wrap. The stack turns cycles into
+//ns with its clock model, so this is all that is needed per frame.
+static inline uint64_t exanicExtendCycles(const exaNicState_t* const exaNicState, const uint32_t cycles)
+{
+    return exaNicState->clkCycles + (int32_t)(cycles - (uint32_t)exaNicState->clkCycles);
 }
 
-void etcpTxTc(void* const txTcState, const cq_t* const datTxQ, const cq_t* ackRxQ, cq_t* ackTxQ, const cq_t* const datRxQ,  bool* const ackFirst, i64* const maxAck_o, i64* const maxDat_o)
-{
-    (void)txTcState;
-    (void)ackRxQ;
-    (void)datRxQ;
-
-    //Send all acks immediately
-    i64 maxAck = 0;
-    if(ackTxQ){
-        i64 i = 0;
-        for(i = ackTxQ->rdMin; i < ackTxQ->rdMax; i++){
-            cqSlot_t* slot = NULL;
-            cqError_t cqe = cqGetRd(ackTxQ,&slot,i);
-            if(cqe != cqENOERR){
-                break;
-            }
-            pBuff_t* pbuff = slot->buff;
-            if(pbuff->txState == ETCP_TX_RDY){
-                pbuff->txState = ETCP_TX_NOW;
-            }
-        }
-        maxAck = i - ackTxQ->rdMin;
-    }
-    *maxAck_o = maxAck;
-    *ackFirst = true;
-
-    const i64 retransmitTimeOut = 1000 * 1000LL; //1ms RTO timeout
-    struct timespec ts = {0};
-    clock_gettime(CLOCK_REALTIME,&ts);
-    const i64 timeNowNs = ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
-
-    i64 maxDat = 0;
-    if(datTxQ){
-        i64 i = 0;
-        for(i = datTxQ->rdMin; i < datTxQ->rdMax; i++){
-            cqSlot_t* slot = NULL;
-            cqError_t cqe = cqGetRd(datTxQ,&slot,i);
-            if(cqe != cqENOERR){
-                break;
-            }
-            pBuff_t* pbuff = slot->buff;
-            if(pbuff->txState != ETCP_TX_RDY){
-                break;
-            }
-
-            const i64 txAttempts  = pbuff->etcpDatHdr->txAttempts;
-
-
-            if(txAttempts == 0){
-                pbuff->txState = ETCP_TX_NOW;
-                continue;
-            }
-            const i64 swTxTimeNs  = pbuff->etcpHdr->ts.swTxTimeNs;
-            const i64 txTimeoutNs = swTxTimeNs + txAttempts * retransmitTimeOut; //calculate when this packet should try again
-            if(txAttempts > 0 &&  txTimeoutNs < timeNowNs){
-                //Slow down a bit, we're sending too hard and not getting acks -- This is where the standard TCP congestion
-                //control would kick in, we've detected loss in the network
-                DBG("PACKET LOST Seq=%li type=%li! txAttempts=%li Time in queue = %lins (%lius)\n", i, pbuff->etcpHdr->type, txAttempts, timeNowNs - swTxTimeNs, (timeNowNs - swTxTimeNs) / 1000);
-                pbuff->txState = ETCP_TX_NOW;
-                //usleep(1);
-                if(txAttempts > 10){
-                    exit(-1);
-                }
-            }
 
-        }
+//Pair the NIC clock with the host clock, for the stack's clock model. The NIC clock is read in between two reads of the
+//host clock, so the pair is out by at most half of the time in between.
+//Returns: >0, a pair was returned, =0, can't read the clocks right now, <0 hw specific error code
+static int64_t exanicClk(void* const hwState, uint64_t* const hwTimeNs_o, int64_t* const swTimeNs_o, int64_t* const errNs_o)
+{
+    exaNicState_t* const exaNicState = hwState;
 
-        maxDat = i - datTxQ->rdMin;
-    }
+    struct timespec before = {0};
+    struct timespec after  = {0};
+    clock_gettime(CLOCK_REALTIME,&before);
+    const uint32_t cycles = exanic_register_read(exaNicState->dev, REG_EXANIC_INDEX(REG_EXANIC_HW_TIME));
+    clock_gettime(CLOCK_REALTIME,&after);
 
+    const int64_t beforeNs = before.tv_sec * 1000 * 1000 * 1000 + before.tv_nsec;
+    const int64_t afterNs  = after.tv_sec * 1000 * 1000 * 1000 + after.tv_nsec;
+    exaNicState->clkCycles = exanicExtendCycles(exaNicState, cycles);
 
-    *maxDat_o = maxDat;
+    *hwTimeNs_o = exaNicState->clkCycles;
+    *swTimeNs_o = beforeNs + (afterNs - beforeNs) / 2;
+    *errNs_o    = (afterNs - beforeNs) / 2;
+    return 1;
 }
 
 
-
-//The ETCP internal state expects to be provided with hardware send and receive operations, these typedefs spell them out
-//A generic wrapper around the "hardware" tx layer
-//Returns: >0, number of bytes transmitted =0, no send capacity, try again, <0 hw specific error code
-static int64_t exanicTx(void* const hwState, const void* const data, const int64_t len, uint64_t* const hwTxTimeNs )
+//libexanic can only give the TX timestamp of the last frame sent (and waits for it to be ready), so give that one back,
+//once per poll. Frames sent before it in the same burst go without. That's one wait per burst, not one per frame.
+//Returns: >0, a completion was returned, =0, nothing has completed right now, <0 hw specific error code
+static int64_t exanicTxTs(void* const hwState, int64_t* const txId_o, uint64_t* const hwTxTimeNs_o)
 {
     exaNicState_t* const exaNicState = hwState;
+    if(exaNicState->txTsNext >= exaNicState->txCount){
+        return 0;
+    }
 
-    //hexdump(data,len);
-    ssize_t result = exanic_transmit_frame(exaNicState->txBuff,(const char*)data, len);
     const uint32_t txTimeCyc = exanic_get_tx_timestamp(exaNicState->txBuff);
-    *hwTxTimeNs = exanic_timestamp_to_counter(exaNicState->dev, txTimeCyc);
-    return result;
+    *hwTxTimeNs_o = exanicExtendCycles(exaNicState, txTimeCyc);
+    *txId_o       = exaNicState->txCount - 1;
+    exaNicState->txTsNext = exaNicState->txCount;
+    return 1;
 }
 
 
@@ -256,7 +230,7 @@ static int64_t exanicRx(void* const hwState, void* const data, const int64_t len
     uint32_t rxTimeCyc = -1;
 
     ssize_t result = exanic_receive_frame(exaNicState->rxBuff, (char*)data, len, &rxTimeCyc);
-    *hwRxTimeNs = exanic_timestamp_to_counter(exaNicState->dev, rxTimeCyc);
+    *hwRxTimeNs = exanicExtendCycles(exaNicState, rxTimeCyc);
 
 //    if(result > 0){
 //        printf("Dumping packet state\n");
@@ -317,7 +291,7 @@ int main(int argc, char* argv[])
     (void)argv;
 
     if(argc < 4){
-        printf("Usage test [client|server] exanic_device exanic_port");
+        printf("Usage test [client|server] exanic_device exanic_port [rto|delay|bbr]");
         return -1;
     }
 
@@ -328,7 +302,27 @@ int main(int argc, char* argv[])
         ERR("Could not connect to exanic\n");
         return -1;
     }
-    etcpState = etcpStateNew(&nicState,exanicTx,exanicRx,etcpTxTc,&tcState,true,etcpRxTc,&tcState,true);
+    //No RX TC, the built-in ack coalescing does the job
+    etcpState = etcpStateNew(&nicState,exanicTx,exanicRx,NULL,NULL,true,NULL,NULL,true);
+    //Or bind the TC in at compile time, see etcpTcStatic.h
+    if(argc > 4 && argv[4][0] == 'd'){
+        etcpTcDelayReset(&tcDelay,NULL);
+        etcpStateSetTxEvtTc(etcpState,etcpTcDelay,&tcDelay);
+        tcTimeouts = &tcDelay.rto;
+        tcName = "delay";
+    }
+    else if(argc > 4 && argv[4][0] == 'b'){
+        etcpTcBbrReset(&tcBbr,NULL);
+        etcpStateSetTxEvtTc(etcpState,etcpTcBbr,&tcBbr);
+        tcTimeouts = &tcBbr.rto;
+        tcName = "bbr";
+    }
+    else{
+        etcpStateSetTxEvtTc(etcpState,etcpTcRto,&tcRto);
+    }
+    etcpStateSetTxTs(etcpState,0,exanicTxTs);
+    etcpStateSetHwClock(etcpState,0,exanicClk);
+    etcpStateSetClock(etcpState,clkTSC,NULL,NULL);
 
     if(argv[1][0] == 's'){
         return etcptpTestServer();
@@ -14,6 +14,7 @@
 #define if_unlikely(x)     if(__builtin_expect((x),0))
 #define if_eqlikely(x)     if(x)
 #define MIN(x,y) ( (x) < (y) ?  (x) : (y))
+#define MAX(x,y) ( (x) > (y) ?  (x) : (y))
 
 
 #endif /* SRC_UTILS_H_ */